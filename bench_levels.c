@@ -0,0 +1,832 @@
+/*
+* This program compares the cost of each level of the minishell. It executes
+* the same workload (some command lines repeated many times) in each program
+* and measures the commands executed per second, the CPU and the wakeups
+* while it waits for input, the memory, the system calls of the minishell
+* for each command (counted with ptrace) and the time from a line to the
+* output of its command. Each level is compared with the previous one, so it
+* shows which step added which cost.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+// Constants:
+#define _GNU_SOURCE
+#define REPEATS 200
+#define TRACED_REPEATS 50
+#define SAMPLES 50
+#define IDLE_MS 1000
+#define TIMEOUT 10
+#define OUTPUT_SIZE 65536
+#define MARK_SIZE 64
+
+// Libraries:
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <signal.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/ptrace.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+/*
+* Structure for the results of a program:
+* ---------------------------------------
+* The values that could not be measured are -1.
+*
+*  program: path of the program.
+*  rate: commands executed per second.
+*  idle_cpu: milliseconds of CPU for each second waiting for input.
+*  idle_wakeups: context switches for each second waiting for input.
+*  idle_rss: resident memory waiting for input, in KB.
+*  max_rss: maximum resident memory executing the workload, in KB.
+*  syscalls: system calls of the minishell for each command.
+*  forks: fork, vfork and clone of the minishell for each command.
+*  latency_p50, latency_p99: microseconds from writing a line to the output
+*                            of its command.
+*/
+struct level_result
+{
+    const char *program;
+    double rate;
+    double idle_cpu;
+    long idle_wakeups;
+    long idle_rss;
+    long max_rss;
+    double syscalls;
+    double forks;
+    long long latency_p50;
+    long long latency_p99;
+};
+
+// Function headers:
+void on_alarm(int signum);
+long long monotonic_us();
+void sleep_ms(int ms);
+pid_t spawn(const char *program, int in, int out, int traced);
+int wait_son(pid_t pid, struct rusage *usage);
+int workload(const char *corpus, int repeats);
+int measure_rate(struct level_result *result, const char *corpus,
+                 int commands);
+int measure_idle(struct level_result *result);
+int measure_syscalls(struct level_result *result, const char *corpus,
+                     int commands);
+long count_syscalls(const char *program, int in, long *forks);
+int measure_latency(struct level_result *result);
+long proc_status(pid_t pid, const char *key);
+long long cpu_ns(pid_t pid);
+int compare(const void *a, const void *b);
+void print_result(struct level_result *result);
+void print_delta(struct level_result *now, struct level_result *before);
+
+// Programs compared by default, in the order of the levels.
+static const char *levels[] = {"./nivel1", "./nivel2", "./nivel3",
+                               "./nivel4", "./nivel5", "./nivel5+",
+                               "./nivel6", "./nivel7", "./my_shell", NULL};
+
+// Workload used if no file is given.
+static const char *default_corpus = "/bin/true\n/bin/echo bench\n";
+
+// Son killed when the alarm expires.
+static volatile pid_t son = 0;
+
+/*
+* Function: Main:
+* ---------------
+* Measures each program and prints a table and the differences between
+* consecutive programs.
+*
+*  argc: number of arguments introduced.
+*  argv: [-n repeticiones] [-w fichero] [programa...].
+*
+*  returns: exit_success if it was executed correctly.
+*/
+int main(int argc, char **argv)
+{
+    int repeats = REPEATS;
+    char *corpus = NULL;
+    int i = 1;
+
+    // Reads the options.
+    while (i < argc && argv[i][0] == '-')
+    {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc &&
+            (repeats = atoi(argv[i + 1])) > 0)
+        {
+            i += 2;
+        }
+        else if (!strcmp(argv[i], "-w") && i + 1 < argc)
+        {
+            // Reads the workload file.
+            FILE *fp = fopen(argv[i + 1], "re");
+            size_t size = 0;
+            if (!fp || getdelim(&corpus, &size, '\0', fp) < 0)
+            {
+                perror(argv[i + 1]);
+                return EXIT_FAILURE;
+            }
+            fclose(fp);
+            i += 2;
+        }
+        else
+        {
+            fprintf(stderr, "Uso: %s [-n repeticiones] [-w fichero] "
+                            "[programa...]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    const char **programs = i < argc ? (const char **)argv + i : levels;
+    int n_programs = 0;
+    while (i < argc ? n_programs < argc - i : programs[n_programs] != NULL)
+    {
+        n_programs++;
+    }
+    if (!corpus && !(corpus = strdup(default_corpus)))
+    {
+        return EXIT_FAILURE;
+    }
+    // Counts the commands of the workload.
+    int lines = 0;
+    for (char *ptr = corpus; *ptr; ptr++)
+    {
+        lines += *ptr == '\n' && ptr != corpus && ptr[-1] != '\n';
+    }
+    struct level_result *results = calloc(n_programs,
+                                          sizeof(struct level_result));
+    if (!results || !lines)
+    {
+        fprintf(stderr, "La carga de trabajo no tiene órdenes.\n");
+        return EXIT_FAILURE;
+    }
+    signal(SIGALRM, on_alarm);
+    signal(SIGPIPE, SIG_IGN);
+
+    // Measures each program.
+    printf("%d órdenes por programa (%d por repetición)\n", lines * repeats,
+           lines);
+    printf("%-12s %10s %11s %11s %9s %9s %9s %7s %9s %9s\n", "programa",
+           "órdenes/s", "CPU ms/s", "despert./s", "RSS KB", "RSSmáx KB",
+           "syscalls", "forks", "lat. p50", "lat. p99");
+    for (int j = 0; j < n_programs; j++)
+    {
+        results[j].program = programs[j];
+        measure_rate(&results[j], corpus, repeats);
+        measure_idle(&results[j]);
+        measure_syscalls(&results[j], corpus,
+                         repeats < TRACED_REPEATS ? repeats : TRACED_REPEATS);
+        measure_latency(&results[j]);
+        print_result(&results[j]);
+    }
+    // Shows the differences with the previous program.
+    printf("\n");
+    for (int j = 1; j < n_programs; j++)
+    {
+        print_delta(&results[j], &results[j - 1]);
+    }
+    free(results);
+    free(corpus);
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: on_alarm:
+* -------------------
+* Kills the son that has not finished in TIMEOUT seconds (some levels wait
+* forever if their son ends before they register it).
+*
+*  signum: number of the signal.
+*
+*  returns: void.
+*/
+void on_alarm(int signum)
+{
+    if (son > 0)
+    {
+        kill(son, SIGKILL);
+    }
+}
+
+/*
+* Function: monotonic_us:
+* -----------------------
+* Returns the time of the monotonic clock.
+*
+*  returns: microseconds of the monotonic clock.
+*/
+long long monotonic_us()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+/*
+* Function: sleep_ms:
+* -------------------
+* Sleeps some milliseconds.
+*
+*  ms: milliseconds to sleep.
+*
+*  returns: void.
+*/
+void sleep_ms(int ms)
+{
+    struct timespec time = {ms / 1000, (ms % 1000) * 1000000L};
+    while (nanosleep(&time, &time) && errno == EINTR)
+    {
+    }
+}
+
+/*
+* Function: spawn:
+* ----------------
+* Executes a program with stdin in a descriptor and stdout and stderr in
+* another one.
+*
+*  program: program to execute.
+*  in: descriptor used as stdin.
+*  out: descriptor used as stdout and stderr.
+*  traced: 1 if the son is traced with ptrace from the exec.
+*
+*  returns: the pid of the son or -1 if it could not be created.
+*/
+pid_t spawn(const char *program, int in, int out, int traced)
+{
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        dup2(in, 0);
+        dup2(out, 1);
+        dup2(out, 2);
+        if (traced)
+        {
+            ptrace(PTRACE_TRACEME, 0, NULL, NULL);
+        }
+        execl(program, program, NULL);
+        _exit(127);
+    }
+    else if (pid < 0)
+    {
+        perror("fork");
+    }
+    son = pid;
+    return pid;
+}
+
+/*
+* Function: wait_son:
+* -------------------
+* Waits for a son, it is killed if it does not end in TIMEOUT seconds.
+*
+*  pid: son to wait for.
+*  usage: pointer where the resources used by the son are stored or NULL.
+*
+*  returns: 0 if the son ended by itself, -1 if it was killed or failed.
+*/
+int wait_son(pid_t pid, struct rusage *usage)
+{
+    int status;
+    alarm(TIMEOUT);
+    pid_t result;
+    while ((result = wait4(pid, &status, 0, usage)) < 0 && errno == EINTR)
+    {
+    }
+    alarm(0);
+    son = 0;
+    if (result < 0 || (WIFSIGNALED(status) && WTERMSIG(status) == SIGKILL) ||
+        (WIFEXITED(status) && WEXITSTATUS(status) == 127))
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+* Function: workload:
+* -------------------
+* Creates a memfd with the workload repeated some times and exit, used as
+* stdin of the minishell, so it reads the lines without waiting.
+*
+*  corpus: command lines of the workload.
+*  repeats: number of times the lines are written.
+*
+*  returns: the memfd at the start or -1 if it could not be created.
+*/
+int workload(const char *corpus, int repeats)
+{
+    int fd = memfd_create("workload", MFD_CLOEXEC);
+    if (fd < 0)
+    {
+        perror("memfd_create");
+        return -1;
+    }
+    size_t length = strlen(corpus);
+    for (int i = 0; i < repeats; i++)
+    {
+        if (write(fd, corpus, length) != (ssize_t)length)
+        {
+            perror("write");
+            close(fd);
+            return -1;
+        }
+    }
+    // The levels do not end at the end of file, all of them have exit.
+    if (write(fd, "exit\n", 5) != 5)
+    {
+        perror("write");
+        close(fd);
+        return -1;
+    }
+    lseek(fd, 0, SEEK_SET);
+    return fd;
+}
+
+/*
+* Function: measure_rate:
+* -----------------------
+* Executes the workload and measures the commands per second and the
+* maximum resident memory.
+*
+*  result: results of the program.
+*  corpus: command lines of the workload.
+*  repeats: number of times the workload is executed.
+*
+*  returns: 0 or -1 if the program did not end.
+*/
+int measure_rate(struct level_result *result, const char *corpus,
+                 int repeats)
+{
+    result->rate = result->max_rss = -1;
+    int lines = 0;
+    for (const char *ptr = corpus; *ptr; ptr++)
+    {
+        lines += *ptr == '\n' && ptr != corpus && ptr[-1] != '\n';
+    }
+    int in = workload(corpus, repeats);
+    int null = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    long long start = monotonic_us();
+    pid_t pid = in < 0 || null < 0 ? -1 : spawn(result->program, in, null, 0);
+    close(in);
+    close(null);
+    struct rusage usage;
+    if (pid < 0 || wait_son(pid, &usage))
+    {
+        fprintf(stderr, "%s: no terminó la carga de trabajo en %d s\n",
+                result->program, TIMEOUT);
+        return -1;
+    }
+    result->rate = lines * repeats * 1e6 / (monotonic_us() - start);
+    result->max_rss = usage.ru_maxrss;
+    return 0;
+}
+
+/*
+* Function: measure_idle:
+* -----------------------
+* Executes the program with stdin in a pipe without data and measures its
+* CPU, its context switches and its resident memory while it waits.
+*
+*  result: results of the program.
+*
+*  returns: 0 or -1 if it could not be measured.
+*/
+int measure_idle(struct level_result *result)
+{
+    result->idle_cpu = result->idle_wakeups = result->idle_rss = -1;
+    int in[2];
+    int null = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    if (null < 0 || pipe2(in, O_CLOEXEC))
+    {
+        perror("pipe");
+        return -1;
+    }
+    pid_t pid = spawn(result->program, in[0], null, 0);
+    close(in[0]);
+    close(null);
+    if (pid < 0)
+    {
+        close(in[1]);
+        return -1;
+    }
+    // Lets the program start and measures the wait.
+    sleep_ms(200);
+    long long cpu = cpu_ns(pid);
+    long switches = proc_status(pid, "voluntary_ctxt_switches") +
+                    proc_status(pid, "nonvoluntary_ctxt_switches");
+    sleep_ms(IDLE_MS);
+    if (cpu >= 0 && cpu_ns(pid) >= 0)
+    {
+        result->idle_cpu = (cpu_ns(pid) - cpu) / 1e3 / IDLE_MS;
+        result->idle_wakeups = (proc_status(pid, "voluntary_ctxt_switches") +
+                                proc_status(pid, "nonvoluntary_ctxt_switches")
+                                - switches) * 1000 / IDLE_MS;
+    }
+    result->idle_rss = proc_status(pid, "VmRSS");
+
+    // The levels do not end at the end of file.
+    if (write(in[1], "exit\n", 5) < 0)
+    {
+        kill(pid, SIGKILL);
+    }
+    close(in[1]);
+    return wait_son(pid, NULL);
+}
+
+/*
+* Function: measure_syscalls:
+* ---------------------------
+* Counts the system calls of the program with the workload and without it,
+* and divides the difference by the number of commands, so the start and
+* the end of the program are not counted.
+*
+*  result: results of the program.
+*  corpus: command lines of the workload.
+*  repeats: number of times the workload is executed.
+*
+*  returns: 0 or -1 if they could not be counted.
+*/
+int measure_syscalls(struct level_result *result, const char *corpus,
+                     int repeats)
+{
+    result->syscalls = result->forks = -1;
+    int lines = 0;
+    for (const char *ptr = corpus; *ptr; ptr++)
+    {
+        lines += *ptr == '\n' && ptr != corpus && ptr[-1] != '\n';
+    }
+    long forks_empty, forks_full;
+    int empty = workload(corpus, 0);
+    int full = workload(corpus, repeats);
+    long calls_empty = empty < 0 ? -1 : count_syscalls(result->program, empty,
+                                                       &forks_empty);
+    long calls_full = full < 0 ? -1 : count_syscalls(result->program, full,
+                                                     &forks_full);
+    close(empty);
+    close(full);
+    if (calls_empty < 0 || calls_full < 0)
+    {
+        return -1;
+    }
+    result->syscalls = (double)(calls_full - calls_empty) / (lines * repeats);
+    result->forks = (double)(forks_full - forks_empty) / (lines * repeats);
+    return 0;
+}
+
+/*
+* Function: count_syscalls:
+* -------------------------
+* Executes the program traced with ptrace and counts its system calls. Its
+* sons are not traced.
+*
+*  program: program to execute.
+*  in: descriptor used as stdin.
+*  forks: pointer where the number of fork, vfork and clone is stored.
+*
+*  returns: the number of system calls or -1 if the program did not end.
+*/
+long count_syscalls(const char *program, int in, long *forks)
+{
+    int null = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    pid_t pid = null < 0 ? -1 : spawn(program, in, null, 1);
+    close(null);
+    int status;
+    if (pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status))
+    {
+        return -1;
+    }
+    // Stops the program at the entry and at the exit of each system call.
+    ptrace(PTRACE_SETOPTIONS, pid, NULL,
+           PTRACE_O_TRACESYSGOOD | PTRACE_O_EXITKILL);
+    long calls = 0;
+    int sig = 0;
+    *forks = 0;
+    alarm(TIMEOUT);
+    while (ptrace(PTRACE_SYSCALL, pid, NULL, sig) == 0)
+    {
+        sig = 0;
+        if (waitpid(pid, &status, 0) < 0 || !WIFSTOPPED(status))
+        {
+            break;
+        }
+        // The other stops are signals received by the program.
+        if (WSTOPSIG(status) != (SIGTRAP | 0x80))
+        {
+            sig = WSTOPSIG(status);
+            continue;
+        }
+        struct __ptrace_syscall_info info;
+        if (ptrace(PTRACE_GET_SYSCALL_INFO, pid, sizeof(info), &info) <= 0 ||
+            info.op != PTRACE_SYSCALL_INFO_ENTRY)
+        {
+            continue;
+        }
+        calls++;
+        long nr = info.entry.nr;
+#ifdef SYS_fork
+        *forks += nr == SYS_fork || nr == SYS_vfork;
+#endif
+#ifdef SYS_clone3
+        *forks += nr == SYS_clone3;
+#endif
+        *forks += nr == SYS_clone;
+    }
+    // The program has ended or has been killed by the alarm.
+    if (WIFSTOPPED(status))
+    {
+        kill(pid, SIGKILL);
+        waitpid(pid, &status, 0);
+    }
+    alarm(0);
+    son = 0;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) == 127)
+    {
+        return -1;
+    }
+    return calls;
+}
+
+/*
+* Function: measure_latency:
+* --------------------------
+* Writes SAMPLES lines "/bin/echo benchN" to the program, with a pause
+* between them so it is waiting for input, and measures the time until the
+* output of each one arrives. It stops at the first line without output.
+*
+*  result: results of the program.
+*
+*  returns: 0 or -1 if no line had output.
+*/
+int measure_latency(struct level_result *result)
+{
+    result->latency_p50 = result->latency_p99 = -1;
+    int in[2], out[2];
+    if (pipe2(in, O_CLOEXEC) || pipe2(out, O_CLOEXEC))
+    {
+        perror("pipe");
+        return -1;
+    }
+    pid_t pid = spawn(result->program, in[0], out[1], 0);
+    close(in[0]);
+    close(out[1]);
+    if (pid < 0)
+    {
+        close(in[1]);
+        close(out[0]);
+        return -1;
+    }
+    fcntl(out[0], F_SETFL, O_NONBLOCK);
+    sleep_ms(200);
+    char *buffer = malloc(OUTPUT_SIZE);
+    long long times[SAMPLES];
+    int n = 0;
+    while (buffer && n < SAMPLES)
+    {
+        // Discards the previous output and writes the line.
+        while (read(out[0], buffer, OUTPUT_SIZE) > 0)
+        {
+        }
+        char line[2 * MARK_SIZE], mark[MARK_SIZE];
+        snprintf(mark, sizeof(mark), "bench%d\n", n);
+        snprintf(line, sizeof(line), "/bin/echo %s", mark);
+        long long start = monotonic_us();
+        if (write(in[1], line, strlen(line)) < 0)
+        {
+            break;
+        }
+        // Reads the output until the mark arrives or a second passes.
+        size_t used = 0;
+        int found = 0;
+        long long left;
+        while (!found && (left = start + 1000000 - monotonic_us()) > 0)
+        {
+            struct pollfd fd = {out[0], POLLIN, 0};
+            if (poll(&fd, 1, left / 1000 + 1) <= 0)
+            {
+                break;
+            }
+            ssize_t length = read(out[0], buffer + used,
+                                  OUTPUT_SIZE - 1 - used);
+            if (length <= 0)
+            {
+                break;
+            }
+            used += length;
+            buffer[used] = '\0';
+            found = strstr(buffer, mark) != NULL;
+
+            // Keeps only the end of the output if the buffer is full.
+            if (!found && used > OUTPUT_SIZE / 2)
+            {
+                memmove(buffer, buffer + used - MARK_SIZE, MARK_SIZE);
+                used = MARK_SIZE;
+            }
+        }
+        if (!found)
+        {
+            break;
+        }
+        times[n++] = monotonic_us() - start;
+        sleep_ms(20);
+    }
+    free(buffer);
+
+    // Ends the program, at once if it has stopped answering.
+    if (n < SAMPLES || write(in[1], "exit\n", 5) < 0)
+    {
+        kill(pid, SIGKILL);
+    }
+    close(in[1]);
+    close(out[0]);
+    wait_son(pid, NULL);
+    if (!n)
+    {
+        return -1;
+    }
+    qsort(times, n, sizeof(long long), compare);
+    result->latency_p50 = times[n / 2];
+    result->latency_p99 = times[(n * 99) / 100];
+    return 0;
+}
+
+/*
+* Function: proc_status:
+* ----------------------
+* Reads a numeric value of /proc/PID/status.
+*
+*  pid: process.
+*  key: name of the value, without ':'.
+*
+*  returns: the value (KB for the memory) or -1 if it does not exist.
+*/
+long proc_status(pid_t pid, const char *key)
+{
+    char path[64], line[256];
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+    FILE *fp = fopen(path, "re");
+    long value = -1;
+    size_t length = strlen(key);
+    while (fp && value < 0 && fgets(line, sizeof(line), fp))
+    {
+        if (!strncmp(line, key, length) && line[length] == ':')
+        {
+            value = atol(line + length + 1);
+        }
+    }
+    if (fp)
+    {
+        fclose(fp);
+    }
+    return value;
+}
+
+/*
+* Function: cpu_ns:
+* -----------------
+* Reads the CPU time used by a process from /proc/PID/schedstat, that has
+* more resolution than the ticks of /proc/PID/stat.
+*
+*  pid: process.
+*
+*  returns: nanoseconds of CPU or -1 if they could not be read.
+*/
+long long cpu_ns(pid_t pid)
+{
+    char path[64];
+    long long cpu = -1;
+    snprintf(path, sizeof(path), "/proc/%d/schedstat", (int)pid);
+    FILE *fp = fopen(path, "re");
+    if (fp)
+    {
+        if (fscanf(fp, "%lld", &cpu) != 1)
+        {
+            cpu = -1;
+        }
+        fclose(fp);
+    }
+    return cpu;
+}
+
+/*
+* Function: compare:
+* ------------------
+* Compares two times for qsort.
+*
+*  returns: negative, zero or positive.
+*/
+int compare(const void *a, const void *b)
+{
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+* Function: print_result:
+* -----------------------
+* Prints the row of a program, the values that could not be measured are
+* shown with "-".
+*
+*  result: results of the program.
+*
+*  returns: void.
+*/
+void print_result(struct level_result *result)
+{
+    char columns[9][32];
+    snprintf(columns[0], 32, result->rate < 0 ? "-" : "%.0f", result->rate);
+    snprintf(columns[1], 32, result->idle_cpu < 0 ? "-" : "%.3f",
+             result->idle_cpu);
+    snprintf(columns[2], 32, result->idle_wakeups < 0 ? "-" : "%ld",
+             result->idle_wakeups);
+    snprintf(columns[3], 32, result->idle_rss < 0 ? "-" : "%ld",
+             result->idle_rss);
+    snprintf(columns[4], 32, result->max_rss < 0 ? "-" : "%ld",
+             result->max_rss);
+    snprintf(columns[5], 32, result->syscalls < 0 ? "-" : "%.1f",
+             result->syscalls);
+    snprintf(columns[6], 32, result->forks < 0 ? "-" : "%.2f", result->forks);
+    snprintf(columns[7], 32, result->latency_p50 < 0 ? "-" : "%lld us",
+             result->latency_p50);
+    snprintf(columns[8], 32, result->latency_p99 < 0 ? "-" : "%lld us",
+             result->latency_p99);
+    printf("%-12s %10s %11s %11s %9s %9s %9s %7s %9s %9s\n", result->program,
+           columns[0], columns[1], columns[2], columns[3], columns[4],
+           columns[5], columns[6], columns[7], columns[8]);
+    fflush(stdout);
+}
+
+/*
+* Function: print_delta:
+* ----------------------
+* Prints the differences of a program with the previous one, only for the
+* values measured in both.
+*
+*  now: results of the program.
+*  before: results of the previous program.
+*
+*  returns: void.
+*/
+void print_delta(struct level_result *now, struct level_result *before)
+{
+    char text[512] = "";
+    size_t used = 0;
+    printf("%s frente a %s:", now->program, before->program);
+    if (now->rate > 0 && before->rate > 0)
+    {
+        used += snprintf(text + used, sizeof(text) - used,
+                         ", órdenes/s %+.1f%%",
+                         100.0 * (now->rate - before->rate) / before->rate);
+    }
+    if (now->idle_cpu >= 0 && before->idle_cpu >= 0)
+    {
+        used += snprintf(text + used, sizeof(text) - used,
+                         ", CPU inactivo %+.3f ms/s",
+                         now->idle_cpu - before->idle_cpu);
+    }
+    if (now->idle_wakeups >= 0 && before->idle_wakeups >= 0)
+    {
+        used += snprintf(text + used, sizeof(text) - used,
+                         ", despertares %+ld/s",
+                         now->idle_wakeups - before->idle_wakeups);
+    }
+    if (now->idle_rss >= 0 && before->idle_rss >= 0)
+    {
+        used += snprintf(text + used, sizeof(text) - used, ", RSS %+ld KB",
+                         now->idle_rss - before->idle_rss);
+    }
+    if (now->max_rss >= 0 && before->max_rss >= 0)
+    {
+        used += snprintf(text + used, sizeof(text) - used,
+                         ", RSS máx %+ld KB", now->max_rss - before->max_rss);
+    }
+    if (now->syscalls >= 0 && before->syscalls >= 0)
+    {
+        used += snprintf(text + used, sizeof(text) - used,
+                         ", syscalls/orden %+.1f",
+                         now->syscalls - before->syscalls);
+    }
+    if (now->forks >= 0 && before->forks >= 0)
+    {
+        used += snprintf(text + used, sizeof(text) - used,
+                         ", forks/orden %+.2f", now->forks - before->forks);
+    }
+    if (now->latency_p50 >= 0 && before->latency_p50 >= 0)
+    {
+        used += snprintf(text + used, sizeof(text) - used,
+                         ", latencia p50 %+lld us",
+                         now->latency_p50 - before->latency_p50);
+    }
+    // The first separator is not printed.
+    printf(" %s\n", used ? text + 2 : "sin valores comparables");
+}
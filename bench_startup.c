@@ -0,0 +1,222 @@
+/*
+* This program measures the cold start of the minishell. It executes it many
+* times with stdin in /dev/null (a script that ends at once) and with a 
+* pseudo terminal that writes "exit" (an interactive session that has to load
+* readline), and prints the mean, the median and the percentile 99 of each.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+// Constants:
+#define _GNU_SOURCE
+#define RUNS 200
+
+// Libraries:
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/wait.h>
+
+// Function headers:
+long long monotonic_us();
+long long run_script(const char *shell);
+long long run_terminal(const char *shell);
+int compare(const void *a, const void *b);
+void report(const char *name, long long *times, int n);
+
+/*
+* Function: Main:
+* ---------------
+* Executes the minishell RUNS times in each mode and prints the results.
+*
+*  argc: number of arguments introduced.
+*  argv: program to measure (./my_shell by default) and number of runs.
+*
+*  returns: exit_success if it was executed correctly.
+*/
+int main(int argc, char **argv)
+{
+    const char *shell = argc > 1 ? argv[1] : "./my_shell";
+    int runs = argc > 2 ? atoi(argv[2]) : RUNS;
+    if (runs <= 0)
+    {
+        fprintf(stderr, "Uso: %s [programa] [ejecuciones]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    long long *times = malloc(sizeof(long long) * runs);
+    if (!times)
+    {
+        return EXIT_FAILURE;
+    }
+    // Measures the minishell executing an empty script.
+    for (int i = 0; i < runs; i++)
+    {
+        if ((times[i] = run_script(shell)) < 0)
+        {
+            free(times);
+            return EXIT_FAILURE;
+        }
+    }
+    report("script", times, runs);
+
+    // Measures the minishell in an interactive session.
+    for (int i = 0; i < runs; i++)
+    {
+        if ((times[i] = run_terminal(shell)) < 0)
+        {
+            free(times);
+            return EXIT_FAILURE;
+        }
+    }
+    report("terminal", times, runs);
+    free(times);
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: monotonic_us:
+* -----------------------
+* Returns the time of the monotonic clock.
+*
+*  returns: microseconds of the monotonic clock.
+*/
+long long monotonic_us()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000LL + now.tv_nsec / 1000;
+}
+
+/*
+* Function: run_script:
+* ---------------------
+* Executes the minishell with stdin in /dev/null and waits for it.
+*
+*  shell: program to execute.
+*
+*  returns: microseconds from the fork to the end or -1 if it fails.
+*/
+long long run_script(const char *shell)
+{
+    long long start = monotonic_us();
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int null = open("/dev/null", O_RDWR);
+        dup2(null, 0);
+        dup2(null, 1);
+        execl(shell, shell, NULL);
+        _exit(127);
+    }
+    else if (pid < 0)
+    {
+        perror("fork");
+        return -1;
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) == 127)
+    {
+        fprintf(stderr, "%s: no se ha podido ejecutar\n", shell);
+        return -1;
+    }
+    return monotonic_us() - start;
+}
+
+/*
+* Function: run_terminal:
+* -----------------------
+* Executes the minishell in a pseudo terminal, writes "exit" and waits for it.
+*
+*  shell: program to execute.
+*
+*  returns: microseconds from the fork to the end or -1 if it fails.
+*/
+long long run_terminal(const char *shell)
+{
+    char buffer[4096];
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) || unlockpt(master))
+    {
+        perror("posix_openpt");
+        return -1;
+    }
+    long long start = monotonic_us();
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        // The pseudo terminal is the controlling terminal of the minishell.
+        setsid();
+        int slave = open(ptsname(master), O_RDWR);
+        close(master);
+        dup2(slave, 0);
+        dup2(slave, 1);
+        dup2(slave, 2);
+        execl(shell, shell, NULL);
+        _exit(127);
+    }
+    else if (pid < 0)
+    {
+        perror("fork");
+        close(master);
+        return -1;
+    }
+    // Writes the command and reads the output until the minishell ends.
+    write(master, "exit\n", 5);
+    while (read(master, buffer, sizeof(buffer)) > 0)
+    {
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    close(master);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) == 127)
+    {
+        fprintf(stderr, "%s: no se ha podido ejecutar\n", shell);
+        return -1;
+    }
+    return monotonic_us() - start;
+}
+
+/*
+* Function: compare:
+* ------------------
+* Compares two times for qsort.
+*
+*  returns: negative, zero or positive.
+*/
+int compare(const void *a, const void *b)
+{
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+/*
+* Function: report:
+* -----------------
+* Sorts the times and prints the mean, the median and the percentile 99.
+*
+*  name: name of the mode.
+*  times: times of each run in microseconds.
+*  n: number of runs.
+*
+*  returns: void.
+*/
+void report(const char *name, long long *times, int n)
+{
+    long long sum = 0;
+    qsort(times, n, sizeof(long long), compare);
+    for (int i = 0; i < n; i++)
+    {
+        sum += times[i];
+    }
+    printf("%-9s %d ejecuciones: media %lld us, p50 %lld us, p99 %lld us\n",
+           name, n, sum / n, times[n / 2], times[(n * 99) / 100]);
+}
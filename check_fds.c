@@ -0,0 +1,273 @@
+/*
+* This program checks the descriptors received by the commands of the
+* minishell. It executes a script with the minishell, with the script file
+* open and an extra descriptor inherited from this program, and the script
+* redirects the descriptor 5 with exec and lists /proc/self/fd with ls, once
+* in a son and once as the last command, which replaces the minishell. Only
+* stdin, stdout, stderr and the descriptor 5 can be in the listings. Then it
+* executes $(...) with the pool of sons, whose commands have to receive the
+* stdout of the substitution and not the one of the pool when it was filled.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+// Constants:
+#define _GNU_SOURCE
+#define OUTPUT_SIZE 65536
+#define SCRIPT_FILE "check_fds.tmp"
+#define REDIRECTION_FILE "check_fds5.tmp"
+#define LISTINGS 2
+// The first ls is executed by a son, the last one replaces the minishell.
+#define FDS_SCRIPT "exec 5>" REDIRECTION_FILE "\n" \
+                   "ls -l /proc/self/fd\n" \
+                   "ls -l /proc/self/fd\n"
+#define POOL_SCRIPT "pool 2\n" \
+                    "f() { /bin/echo inner; }\n" \
+                    "/bin/echo [$(f)]\n" \
+                    "/bin/echo [$(/bin/echo ext)]\n" \
+                    "pool\n"
+#define POOL_OUTPUT "[inner]\n[ext]\n"
+
+// Libraries:
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+// Function headers:
+int write_script(const char *path, const char *text);
+int run_shell(const char *shell, const char *script, char *output,
+              size_t size);
+int check_listing(char *output);
+int check_pool(const char *output);
+
+/*
+* Function: Main:
+* ---------------
+* Executes the scripts with the minishell and checks their output.
+*
+*  argc: number of arguments introduced.
+*  argv: program to check (./my_shell by default).
+*
+*  returns: exit_success if only the expected descriptors were received and
+*           the pool wrote in the substitutions, otherwise exit failure.
+*/
+int main(int argc, char **argv)
+{
+    const char *shell = argc > 1 ? argv[1] : "./my_shell";
+    if (argc > 2)
+    {
+        fprintf(stderr, "Uso: %s [programa]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    static char output[OUTPUT_SIZE];
+    if (write_script(SCRIPT_FILE, FDS_SCRIPT) ||
+        run_shell(shell, SCRIPT_FILE, output, sizeof(output)))
+    {
+        unlink(SCRIPT_FILE);
+        unlink(REDIRECTION_FILE);
+        return EXIT_FAILURE;
+    }
+    unlink(REDIRECTION_FILE);
+    if (check_listing(output))
+    {
+        fprintf(stderr, "Salida de %s:\n%s", shell, output);
+        unlink(SCRIPT_FILE);
+        return EXIT_FAILURE;
+    }
+    printf("%s: las órdenes solo reciben 0, 1, 2 y 5\n", shell);
+
+    // Substitutions executed by the sons of the pool.
+    int result = write_script(SCRIPT_FILE, POOL_SCRIPT) ||
+                 run_shell(shell, SCRIPT_FILE, output, sizeof(output));
+    unlink(SCRIPT_FILE);
+    if (result)
+    {
+        return EXIT_FAILURE;
+    }
+    if (check_pool(output))
+    {
+        fprintf(stderr, "Salida de %s:\n%s", shell, output);
+        return EXIT_FAILURE;
+    }
+    printf("%s: las sustituciones $(...) con el pool escriben en su salida\n",
+           shell);
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: write_script:
+* -----------------------
+* Writes a script executed by the minishell.
+*
+*  path: name of the script file.
+*  text: lines of the script.
+*
+*  returns: 0 or -1 if the file could not be written.
+*/
+int write_script(const char *path, const char *text)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+    {
+        perror(path);
+        return -1;
+    }
+    fputs(text, fp);
+    if (fclose(fp))
+    {
+        perror(path);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+* Function: run_shell:
+* --------------------
+* Executes the minishell with the script and reads its output. The son
+* inherits an extra descriptor that is not close on exec, the minishell has
+* to close it for its commands.
+*
+*  shell: program to execute.
+*  script: name of the script file.
+*  output: buffer for the output, it ends with '\0'.
+*  size: size of the buffer.
+*
+*  returns: 0 or -1 if the minishell could not be executed or failed.
+*/
+int run_shell(const char *shell, const char *script, char *output,
+              size_t size)
+{
+    int pipe_fd[2];
+    if (pipe(pipe_fd))
+    {
+        perror("pipe");
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        int null = open("/dev/null", O_RDWR);
+        dup2(null, 0);
+        dup2(pipe_fd[1], 1);
+        close(pipe_fd[0]);
+        close(pipe_fd[1]);
+        // Descriptor inherited by the minishell.
+        dup2(null, 7);
+        execl(shell, shell, script, NULL);
+        _exit(127);
+    }
+    else if (pid < 0)
+    {
+        perror("fork");
+        close(pipe_fd[0]);
+        close(pipe_fd[1]);
+        return -1;
+    }
+    close(pipe_fd[1]);
+    size_t used = 0;
+    ssize_t n;
+    while (used < size - 1 &&
+           (n = read(pipe_fd[0], output + used, size - 1 - used)) > 0)
+    {
+        used += n;
+    }
+    output[used] = '\0';
+    close(pipe_fd[0]);
+    int status;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status))
+    {
+        fprintf(stderr, "%s: no se ha podido ejecutar el script\n", shell);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+* Function: check_listing:
+* ------------------------
+* Checks the lines of the listings of ls. Each descriptor line ends with
+* "N -> file"; the descriptor that ls opens to read /proc/self/fd is
+* allowed.
+*
+*  output: output of the minishell.
+*
+*  returns: 0 if the listings are correct, -1 otherwise.
+*/
+int check_listing(char *output)
+{
+    int listings = 0;
+    int result = 0;
+    char *line = output;
+    while (*line)
+    {
+        // Each line is ended while it is checked, the output is kept.
+        char *end = line + strcspn(line, "\n");
+        char saved = *end;
+        *end = '\0';
+        char *arrow = strstr(line, " -> ");
+        if (!strncmp(line, "total ", 6))
+        {
+            listings++;
+        }
+        else if (arrow)
+        {
+            char *name = arrow;
+            while (name > line && name[-1] != ' ')
+            {
+                name--;
+            }
+            int fd = atoi(name);
+            if (fd > 2 && fd != 5 && !strstr(arrow, "/fd"))
+            {
+                fprintf(stderr, "El descriptor %d no se ha cerrado: %s\n",
+                        fd, line);
+                result = -1;
+            }
+        }
+        *end = saved;
+        line = saved ? end + 1 : end;
+    }
+    if (listings != LISTINGS)
+    {
+        fprintf(stderr, "Se esperaban %d listados y hay %d\n", LISTINGS,
+                listings);
+        result = -1;
+    }
+    return result;
+}
+
+/*
+* Function: check_pool:
+* ---------------------
+* Checks the output of the substitutions and that the pool was used.
+*
+*  output: output of the minishell.
+*
+*  returns: 0 if the output is correct, -1 otherwise.
+*/
+int check_pool(const char *output)
+{
+    unsigned long hits = 0;
+    size_t length = strlen(POOL_OUTPUT);
+    if (strncmp(output, POOL_OUTPUT, length))
+    {
+        fprintf(stderr, "Las sustituciones no han escrito %s", POOL_OUTPUT);
+        return -1;
+    }
+    if (sscanf(output + length, "pool: %*d hijos preparados de %*d, %lu",
+               &hits) != 1 || !hits)
+    {
+        fprintf(stderr, "El pool no ha ejecutado ninguna orden\n");
+        return -1;
+    }
+    return 0;
+}
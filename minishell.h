@@ -0,0 +1,61 @@
+/*
+* Public interface of libminishell, the library with the parser, the executor
+* and the job table of the minishell. It allows other programs to execute
+* command lines of the minishell without creating a shell for each one.
+*
+* Only one context can exist at a time: ms_create returns NULL while there is
+* one. It receives the signals of the process (SIGCHLD, SIGINT and SIGTSTP),
+* but it only waits for the sons it has created, the other sons of the 
+* program are not taken.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#ifndef MINISHELL_H
+#define MINISHELL_H
+
+#include <sys/types.h>
+
+// Context with all the state of a minishell (jobs, queue, event loop...).
+struct ms_context;
+
+/*
+* Structure with the information of a job given to ms_jobs_iter:
+* --------------------------------------------------------------
+*  index: position of the job in the jobs list or in the queue.
+*  pid: pid of the job, 0 if it is queued.
+*  status: E executed, D stopped or Q queued.
+*  command_line: command name and his arguments.
+*/
+struct ms_job_info
+{
+    int index;
+    pid_t pid;
+    char status;
+    const char *command_line;
+};
+
+// Function headers:
+struct ms_context *ms_create(const char *name);
+void ms_destroy(struct ms_context *ctx);
+int ms_exec_line(struct ms_context *ctx, const char *line);
+int ms_source(struct ms_context *ctx, const char *path);
+int ms_exec_script(struct ms_context *ctx, const char *text);
+void ms_set_exec_last(struct ms_context *ctx, int enabled);
+int ms_jobs_iter(struct ms_context *ctx,
+                 int (*callback)(const struct ms_job_info *job, void *data),
+                 void *data);
+int ms_wait(struct ms_context *ctx, int fd);
+int ms_pump(struct ms_context *ctx);
+int ms_drain(struct ms_context *ctx);
+int ms_notify(struct ms_context *ctx);
+int ms_listen(struct ms_context *ctx, const char *path);
+void ms_set_interrupt_hook(struct ms_context *ctx, void (*hook)(void));
+void ms_trace(struct ms_context *ctx, char phase, const char *name,
+              const char *detail, long arg);
+
+#endif
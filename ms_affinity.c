@@ -0,0 +1,343 @@
+/*
+* CPU affinity of libminishell: the internal command pin and the automatic
+* distribution of the background jobs between the CPUs and NUMA nodes.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#include "ms_internal.h"
+
+/*
+* Function: internal_pin:
+* -----------------------
+* Controls the CPU affinity of the jobs. "pin CPUS orden" executes a command
+* pinned to a list of CPUs (for example 0-3,8), "pin %n CPUS" pins the job n
+* and "pin -a rr|least|off" changes the automatic policy for background jobs:
+* round robin or least loaded CPU, alternating the NUMA nodes. Without 
+* arguments it shows the policy and the CPUs of each NUMA node.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: exit success or exit failure if the command was not correct.
+*/
+int internal_pin(char **args)
+{
+    struct launch_options options;
+    memset(&options, 0, sizeof(options));
+
+    // Shows the policy and the topology.
+    if (!args[1])
+    {
+        const char *policies[] = {"off", "rr", "least"};
+        if (pin_topology_load())
+        {
+            return EXIT_FAILURE;
+        }
+        printf("Política: %s\n", policies[ms->pin_policy]);
+        for (int i = 0; i < ms->n_pin_cpus; i++)
+        {
+            printf("CPU %d\tnodo %d\n", ms->pin_cpus[i], ms->pin_nodes[i]);
+        }
+        return EXIT_SUCCESS;
+    }
+    // Changes the automatic policy.
+    if (!strcmp(args[1], "-a") && args[2] && !args[3])
+    {
+        if (!strcmp(args[2], "off"))
+        {
+            ms->pin_policy = PIN_OFF;
+            return EXIT_SUCCESS;
+        }
+        if (pin_topology_load())
+        {
+            return EXIT_FAILURE;
+        }
+        if (!strcmp(args[2], "rr"))
+        {
+            ms->pin_policy = PIN_ROUND_ROBIN;
+            return EXIT_SUCCESS;
+        }
+        else if (!strcmp(args[2], "least"))
+        {
+            ms->pin_policy = PIN_LEAST_LOADED;
+            return EXIT_SUCCESS;
+        }
+    }
+    // Pins a job of the jobs_list.
+    else if (args[1][0] == '%' && args[2] && !args[3])
+    {
+        int job = job_spec(args[1], 0);
+        if (job < 0)
+        {
+            return EXIT_FAILURE;
+        }
+        if (parse_cpu_list(args[2], &options.cpus))
+        {
+            fprintf(stderr, "Lista de CPUs no válida: %s\n", args[2]);
+            return EXIT_FAILURE;
+        }
+        ms->jobs_list[job].cpu = -1;
+        return pin_process(ms->jobs_list[job].pid, &options.cpus);
+    }
+    // Executes a command pinned to the CPUs.
+    else if (args[2])
+    {
+        if (parse_cpu_list(args[1], &options.cpus))
+        {
+            fprintf(stderr, "Lista de CPUs no válida: %s\n", args[1]);
+            return EXIT_FAILURE;
+        }
+        options.has_cpus = 1;
+        int bkg;
+        pid_t pid = launch_prefixed(args, &args[2], &options, &bkg);
+        if (pid > 0 && !bkg)
+        {
+            return wait_foreground(ms->jobs_list[FOREGROUND].command_line);
+        }
+        return pid > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    fprintf(stderr, "La sintaxis es errónea, pin CPUS orden | pin %%n CPUS | "
+                    "pin -a rr|least|off\n");
+    return EXIT_FAILURE;
+}
+
+/*
+* Function: parse_cpu_list:
+* -------------------------
+* Converts a list of CPUs in the format used by the kernel (0-3,8,10-11) to a
+* set of CPUs.
+*
+*  text: list of CPUs.
+*  cpus: pointer where the set of CPUs will be stored.
+*
+*  returns: exit success or exit failure if the list is not valid.
+*/
+int parse_cpu_list(char *text, cpu_set_t *cpus)
+{
+    CPU_ZERO(cpus);
+    char *end = text;
+    while (*end && *end != '\n')
+    {
+        // Reads the first CPU of the range and the last one if there is one.
+        long first = strtol(text, &end, 10);
+        long last = first;
+        if (end == text || first < 0)
+        {
+            return EXIT_FAILURE;
+        }
+        if (*end == '-')
+        {
+            text = end + 1;
+            last = strtol(text, &end, 10);
+            if (end == text || last < first)
+            {
+                return EXIT_FAILURE;
+            }
+        }
+        if (last >= CPU_SETSIZE)
+        {
+            return EXIT_FAILURE;
+        }
+        for (long cpu = first; cpu <= last; cpu++)
+        {
+            CPU_SET(cpu, cpus);
+        }
+        // Skips the separator.
+        if (*end == ',')
+        {
+            end++;
+        }
+        else if (*end && *end != '\n')
+        {
+            return EXIT_FAILURE;
+        }
+        text = end;
+    }
+    return CPU_COUNT(cpus) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+* Function: pin_topology_load:
+* ----------------------------
+* Reads the CPUs that the minishell can use and their NUMA node from sysfs 
+* the first time it is called. The CPUs are ordered taking one of each node 
+* in turn. If there is no NUMA information all CPUs are in node 0.
+*
+*  returns: exit success or exit failure if the CPUs could not be read.
+*/
+int pin_topology_load()
+{
+    cpu_set_t allowed, node_cpus;
+    int nodes[CPU_SETSIZE];
+    char path[COMMAND_LINE_SIZE];
+    char text[COMMAND_LINE_SIZE];
+
+    // The topology is only read once.
+    if (ms->n_pin_cpus)
+    {
+        return EXIT_SUCCESS;
+    }
+    if (sched_getaffinity(0, sizeof(allowed), &allowed))
+    {
+        perror("sched_getaffinity");
+        return EXIT_FAILURE;
+    }
+    // Assigns a node to each allowed CPU.
+    int max_node = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    {
+        nodes[cpu] = 0;
+    }
+    DIR *dir = opendir(NODES_PATH);
+    struct dirent *entry;
+    while (dir && (entry = readdir(dir)))
+    {
+        int node;
+        if (sscanf(entry->d_name, "node%d", &node) != 1)
+        {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s/cpulist", NODES_PATH,
+                 entry->d_name);
+        FILE *fp = fopen(path, "re");
+        if (fp && fgets(text, sizeof(text), fp) &&
+            !parse_cpu_list(text, &node_cpus))
+        {
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            {
+                if (CPU_ISSET(cpu, &node_cpus))
+                {
+                    nodes[cpu] = node;
+                }
+            }
+            max_node = node > max_node ? node : max_node;
+        }
+        if (fp)
+        {
+            fclose(fp);
+        }
+    }
+    if (dir)
+    {
+        closedir(dir);
+    }
+    // Orders the CPUs taking the k-th CPU of every node in turn.
+    for (int k = 0; ms->n_pin_cpus < CPU_COUNT(&allowed); k++)
+    {
+        for (int node = 0; node <= max_node; node++)
+        {
+            int seen = 0;
+            for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            {
+                if (CPU_ISSET(cpu, &allowed) && nodes[cpu] == node &&
+                    seen++ == k)
+                {
+                    ms->pin_cpus[ms->n_pin_cpus] = cpu;
+                    ms->pin_nodes[ms->n_pin_cpus] = node;
+                    ms->n_pin_cpus++;
+                    break;
+                }
+            }
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: pin_choose_cpu:
+* -------------------------
+* Chooses the CPU for a new background job with the automatic policy. Round
+* robin goes through the CPUs alternating the nodes. Least loaded chooses the 
+* node with less jobs per CPU and the CPU of that node with less jobs.
+*
+*  returns: the chosen CPU or -1 if there are no CPUs.
+*/
+int pin_choose_cpu()
+{
+    int load[CPU_SETSIZE];
+    int node_load[CPU_SETSIZE];
+    int node_cpus[CPU_SETSIZE];
+
+    if (!ms->n_pin_cpus)
+    {
+        return -1;
+    }
+    if (ms->pin_policy == PIN_ROUND_ROBIN)
+    {
+        return ms->pin_cpus[ms->pin_next++ % ms->n_pin_cpus];
+    }
+    // Counts the background jobs of each CPU and node.
+    memset(node_load, 0, sizeof(node_load));
+    memset(node_cpus, 0, sizeof(node_cpus));
+    for (int i = 0; i < ms->n_pin_cpus; i++)
+    {
+        load[i] = 0;
+        for (int job = 1; job < ms->jobs_used; job++)
+        {
+            load[i] += ms->jobs_list[job].pid &&
+                       ms->jobs_list[job].cpu == ms->pin_cpus[i];
+        }
+        node_load[ms->pin_nodes[i]] += load[i];
+        node_cpus[ms->pin_nodes[i]]++;
+    }
+    // Chooses the node with less load per CPU and its CPU with less load.
+    int best = 0;
+    for (int i = 1; i < ms->n_pin_cpus; i++)
+    {
+        int node = ms->pin_nodes[i];
+        int best_node = ms->pin_nodes[best];
+        long long ratio = (long long)node_load[node] * node_cpus[best_node];
+        long long best_ratio = (long long)node_load[best_node] * 
+                               node_cpus[node];
+        if (ratio < best_ratio || (node == best_node && load[i] < load[best]))
+        {
+            best = i;
+        }
+    }
+    return ms->pin_cpus[best];
+}
+
+/*
+* Function: pin_process:
+* ----------------------
+* Pins all the threads of a process to a set of CPUs.
+*
+*  pid: process to pin.
+*  cpus: CPUs where the process can be executed.
+*
+*  returns: exit success or exit failure if the process could not be pinned.
+*/
+int pin_process(pid_t pid, cpu_set_t *cpus)
+{
+    char path[COMMAND_LINE_SIZE];
+    int result = EXIT_SUCCESS;
+
+    // Changes the affinity of the process.
+    if (sched_setaffinity(pid, sizeof(cpu_set_t), cpus))
+    {
+        perror("sched_setaffinity");
+        return EXIT_FAILURE;
+    }
+    // Changes the affinity of the other threads of the process.
+    snprintf(path, sizeof(path), "/proc/%d/task", pid);
+    DIR *dir = opendir(path);
+    struct dirent *entry;
+    while (dir && (entry = readdir(dir)))
+    {
+        pid_t tid = atoi(entry->d_name);
+        if (tid > 0 && tid != pid &&
+            sched_setaffinity(tid, sizeof(cpu_set_t), cpus))
+        {
+            result = EXIT_FAILURE;
+        }
+    }
+    if (dir)
+    {
+        closedir(dir);
+    }
+    return result;
+}
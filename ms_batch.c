@@ -0,0 +1,992 @@
+/*
+* Batches of libminishell: jobs executed in parallel with a maximum number of
+* slots, whose output is kept in a memfd for each job and written in the
+* order of the jobs. They are used by source -j and by the internal commands
+* parallel and mapchunks.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#include "ms_internal.h"
+
+/*
+* Function: batch_run:
+* --------------------
+* Executes the jobs of a batch. The jobs are launched while there are free
+* slots and less than BATCH_WINDOW outputs kept, and the output of each job
+* is written when it and the jobs before it have finished. Ctrl+C, or a job
+* that fails if the batch has fail_fast, stops the batch: the running jobs
+* receive SIGTERM and the rest are not launched.
+*
+*  batch: batch to execute, failed is updated.
+*
+*  returns: the number of jobs that have been executed.
+*/
+int batch_run(struct batch *batch)
+{
+    int next = 0;
+    int flushed = 0;
+    int running = 0;
+    int stopped = 0;
+    batch->failed = -1;
+    for (int job = 0; job < batch->n_jobs; job++)
+    {
+        batch->jobs[job].pid = 0;
+        batch->jobs[job].position = -1;
+        batch->jobs[job].output[0] = batch->jobs[job].output[1] = -1;
+        batch->jobs[job].status = -1;
+    }
+    trace_event('B', "batch", "", batch->n_jobs);
+
+    // The output of the minishell goes before the output of the jobs.
+    fflush(stdout);
+    while (flushed < batch->n_jobs)
+    {
+        // Launches jobs while there are free slots.
+        while (!stopped && next < batch->n_jobs && running < batch->slots &&
+               next - flushed < BATCH_WINDOW)
+        {
+            if (!batch_launch(batch, next))
+            {
+                running++;
+            }
+            else if (batch->failed < 0)
+            {
+                batch->failed = next;
+            }
+            next++;
+        }
+        if (batch->pump)
+        {
+            batch->pump(batch);
+        }
+        // Collects the finished jobs and writes their output in order.
+        running -= batch_collect(batch, flushed, next);
+        while (flushed < next && batch->jobs[flushed].status >= 0)
+        {
+            batch_flush(&batch->jobs[flushed]);
+            flushed++;
+        }
+        // Stops the batch.
+        if (!stopped &&
+            (ms->interrupted || (batch->fail_fast && batch->failed >= 0)))
+        {
+            stopped = 1;
+            batch_stop(batch, flushed, next);
+        }
+        if (stopped && flushed == next)
+        {
+            break;
+        }
+        // Waits for a job if no other job can be launched.
+        if (running && (stopped || next == batch->n_jobs ||
+                        running == batch->slots ||
+                        next - flushed == BATCH_WINDOW))
+        {
+            event_wait(-1);
+        }
+    }
+    trace_event('E', "batch", "", flushed);
+    return flushed;
+}
+
+/*
+* Function: batch_launch:
+* -----------------------
+* Creates the memfds of the output of a job and launches it.
+*
+*  batch: batch of the job.
+*  job: index of the job.
+*
+*  returns: exit success or exit failure if the job could not be launched,
+*           then its status is exit failure.
+*/
+int batch_launch(struct batch *batch, int job)
+{
+    struct batch_job *info = &batch->jobs[job];
+    struct launch_options options;
+    memset(&options, 0, sizeof(options));
+
+    // Creates the memfds for stdout and stderr.
+    info->output[0] = memfd_create("ms_batch_out", MFD_CLOEXEC);
+    info->output[1] = memfd_create("ms_batch_err", MFD_CLOEXEC);
+    if (info->output[0] < 0 || info->output[1] < 0)
+    {
+        perror("memfd_create");
+        info->status = EXIT_FAILURE;
+        return EXIT_FAILURE;
+    }
+    options.has_output = 1;
+    options.output[0] = info->output[0];
+    options.output[1] = info->output[1];
+    options.batch = 1;
+
+    // Launches the job, it must be in the jobs_list to be collected.
+    info->pid = batch->launch(batch, job, &options);
+    info->position = info->pid > 0 ? jobs_list_find(info->pid) : -1;
+    if (info->position <= 0)
+    {
+        info->status = EXIT_FAILURE;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: batch_collect:
+* ------------------------
+* Saves the exit status of the jobs of a batch that have finished and removes
+* them from the jobs_list. The first job that does not end with status 0 is
+* saved in failed.
+*
+*  batch: batch of the jobs.
+*  first, next: the jobs from first to next - 1 are checked.
+*
+*  returns: the number of jobs collected.
+*/
+int batch_collect(struct batch *batch, int first, int next)
+{
+    int collected = 0;
+    reap_drain();
+    for (int job = first; job < next; job++)
+    {
+        struct batch_job *info = &batch->jobs[job];
+        if (info->status >= 0 ||
+            ms->jobs_list[info->position].pid != info->pid ||
+            ms->jobs_list[info->position].status != FINALIZED)
+        {
+            continue;
+        }
+        info->status = exit_status(ms->jobs_list[info->position].wait_status);
+        jobs_list_remove(info->position);
+        if (info->status && batch->failed < 0)
+        {
+            batch->failed = job;
+        }
+        collected++;
+    }
+    return collected;
+}
+
+/*
+* Function: batch_stop:
+* ---------------------
+* Sends SIGTERM to the running jobs of a batch and to their sons.
+*
+*  batch: batch of the jobs.
+*  first, next: the jobs from first to next - 1 are checked.
+*
+*  returns: void.
+*/
+void batch_stop(struct batch *batch, int first, int next)
+{
+    for (int job = first; job < next; job++)
+    {
+        if (batch->jobs[job].status < 0)
+        {
+            kill(-batch->jobs[job].pid, SIGTERM);
+        }
+    }
+}
+
+/*
+* Function: batch_flush:
+* ----------------------
+* Writes the output of a finished job to stdout and stderr and closes its
+* memfds.
+*
+*  job: job of a batch.
+*
+*  returns: exit success or exit failure if the output could not be written.
+*/
+int batch_flush(struct batch_job *job)
+{
+    int result = EXIT_SUCCESS;
+    fflush(stdout);
+    for (int i = 0; i < 2; i++)
+    {
+        if (job->output[i] < 0)
+        {
+            continue;
+        }
+        off_t length = lseek(job->output[i], 0, SEEK_END);
+        if (length > 0 && cache_send(i + 1, job->output[i], 0, length, NULL))
+        {
+            result = EXIT_FAILURE;
+        }
+        close(job->output[i]);
+        job->output[i] = -1;
+    }
+    return result;
+}
+
+/*
+* Function: batch_source:
+* -----------------------
+* Executes the commands of a script with source -j. The script is divided in
+* stages by the empty lines and the lines of a stage are executed at the
+* same time, each one in a subshell. The lines that change the minishell
+* (see batch_serial) are executed in it alone, after the lines before them.
+* If a line fails the rest of the script is not executed.
+*
+*  script: node with the list of commands of the script.
+*  slots: maximum number of lines executed at the same time.
+*
+*  returns: the exit status of the line that failed, 130 after Ctrl+C or 0.
+*/
+int batch_source(struct script_node *script, int slots)
+{
+    struct script_node *node = script->body;
+    int status = EXIT_SUCCESS;
+    while (node && !status && !ms->interrupted)
+    {
+        int line = node->line;
+
+        // Executes the lines that change the minishell.
+        if (batch_serial(node))
+        {
+            struct script_node *end = batch_next(node);
+            for (; node != end && !script_stopped(); node = node->next)
+            {
+                int statuses[ARGS_SIZE];
+                int n_statuses = 0;
+                script_chain(node, statuses, &n_statuses);
+            }
+            node = end;
+            status = ms->last_status;
+            jobs_notify();
+        }
+        else
+        {
+            // The stage ends with an empty line or a line that changes the
+            // minishell.
+            int n = 0;
+            struct script_node *end = node;
+            do
+            {
+                n++;
+                end = batch_next(end);
+            } while (end && !end->blank && !batch_serial(end));
+            struct script_node **lines = malloc(sizeof(*lines) * n);
+            struct batch_job *jobs = malloc(sizeof(*jobs) * n);
+            if (!lines || !jobs)
+            {
+                perror("malloc");
+                free(lines);
+                free(jobs);
+                return ms->last_status = EXIT_FAILURE;
+            }
+            for (int i = 0; i < n; i++, node = batch_next(node))
+            {
+                lines[i] = node;
+            }
+            // Executes the stage and keeps the first line that failed.
+            struct batch batch = {jobs, n, slots, 1, -1, batch_source_launch,
+                                  lines, NULL};
+            batch_run(&batch);
+            if (batch.failed >= 0)
+            {
+                status = jobs[batch.failed].status;
+                line = lines[batch.failed]->line;
+            }
+            free(lines);
+            free(jobs);
+        }
+        if (status && !ms->interrupted)
+        {
+            fprintf(stderr, "source: la línea %d ha terminado con estado %d, "
+                            "no se ejecuta el resto del fichero\n", line,
+                    status);
+        }
+    }
+    if (ms->interrupted)
+    {
+        status = 130;
+    }
+    return ms->last_status = status;
+}
+
+/*
+* Function: batch_serial:
+* -----------------------
+* Checks if a line of a script changes the minishell, so it can not be
+* executed in a subshell: it defines a function or it has a chain that 
+* starts with cd, export, alias, unalias, wait, exit or exec.
+*
+*  node: first command of the line.
+*
+*  returns: 1 if it has to be executed in the minishell, otherwise 0.
+*/
+int batch_serial(struct script_node *node)
+{
+    const char *names[] = {"cd", "export", "alias", "unalias", "wait", "exit",
+                           "exec", NULL};
+    struct script_node *end = batch_next(node);
+    for (; node != end; node = node->next)
+    {
+        struct script_node *first = node;
+        while (first->type == NODE_AND || first->type == NODE_OR)
+        {
+            first = first->condition;
+        }
+        if (first->type == NODE_FUNCTION)
+        {
+            return 1;
+        }
+        for (int i = 0; first->type == NODE_COMMAND && names[i]; i++)
+        {
+            if (!strcmp(first->words.data, names[i]))
+            {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+* Function: batch_next:
+* ---------------------
+* Looks for the next line of a script, the commands separated by ";" are in
+* the same line.
+*
+*  node: command of the script.
+*
+*  returns: the first command of the next line or NULL.
+*/
+struct script_node *batch_next(struct script_node *node)
+{
+    do
+    {
+        node = node->next;
+    } while (node && !node->newline);
+    return node;
+}
+
+/*
+* Function: batch_source_launch:
+* ------------------------------
+* Launches a line of a script in a subshell, used by batch_source. The 
+* jobs_list shows the simple commands and the number of the other lines.
+*
+*  batch: batch of the stage, data is the array of lines.
+*  job: index of the line.
+*  options: options of the son given by the batch.
+*
+*  returns: the pid of the son or -1.
+*/
+pid_t batch_source_launch(struct batch *batch, int job,
+                          struct launch_options *options)
+{
+    struct script_node *node = ((struct script_node **)batch->data)[job];
+    char command[COMMAND_LINE_SIZE];
+    char *tokens[ARGS_SIZE];
+    char *text = NULL;
+    struct script_node *end = batch_next(node);
+    if (node->type == NODE_COMMAND && node->next == end &&
+        (text = script_words(node, tokens)))
+    {
+        join_args(tokens, command);
+    }
+    else
+    {
+        snprintf(command, COMMAND_LINE_SIZE, "source: línea %d", node->line);
+    }
+    free(text);
+
+    // The son executes a list with the commands of the line, that is cut 
+    // while the son is created.
+    struct script_node list;
+    memset(&list, 0, sizeof(list));
+    list.type = NODE_LIST;
+    list.body = node;
+    struct script_node *last = node;
+    while (last->next != end)
+    {
+        last = last->next;
+    }
+    last->next = NULL;
+    char *args[] = {"source", NULL};
+    options->script = &list;
+    pid_t pid = launch_job(args, command, 1, options);
+    last->next = end;
+    return pid;
+}
+
+/*
+* Function: internal_parallel:
+* ----------------------------
+* Executes a command for each input in a batch: parallel [-j N] [--fail-fast]
+* orden ::: entradas... or parallel [-j N] [--fail-fast] orden < fichero 
+* (also :::: fichero), with an input for each line of the file. {} in the
+* command is replaced by the input, without {} the input is the last 
+* argument. The output of each job is written in the order of the inputs 
+* and the inputs that fail are shown at the end.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: the number of jobs that did not end with status 0 (at most 
+*           101), 130 after Ctrl+C or exit failure if the command was not 
+*           correct.
+*/
+int internal_parallel(char **args)
+{
+    struct parallel_options parallel;
+    memset(&parallel, 0, sizeof(parallel));
+    int slots = sysconf(_SC_NPROCESSORS_ONLN);
+    int fail_fast = 0;
+    int i = 1;
+    if (slots < 1)
+    {
+        slots = 1;
+    }
+
+    // Reads the options.
+    while (args[i] && args[i][0] == '-')
+    {
+        if (!strcmp(args[i], "-j") && args[i + 1])
+        {
+            char *end;
+            slots = strtol(args[i + 1], &end, 10);
+            if (*end || slots < 1)
+            {
+                fprintf(stderr, "El número de trabajos debe ser mayor que "
+                                "0.\n");
+                return EXIT_FAILURE;
+            }
+            i += 2;
+        }
+        else if (!strcmp(args[i], "--fail-fast"))
+        {
+            fail_fast = 1;
+            i++;
+        }
+        else
+        {
+            break;
+        }
+    }
+    // The command ends with the inputs.
+    int end = i;
+    while (args[end] && strcmp(args[end], ":::") &&
+           strcmp(args[end], "::::") && strcmp(args[end], "<"))
+    {
+        end++;
+    }
+    int from_file = args[end] && strcmp(args[end], ":::");
+    if (end == i || !args[end] || (from_file && (!args[end + 1] ||
+                                                  args[end + 2])))
+    {
+        fprintf(stderr, "La sintaxis es errónea, parallel [-j N] [--fail-fast]"
+                        " orden ::: entradas... | orden < fichero\n");
+        return EXIT_FAILURE;
+    }
+    parallel.command = &args[i];
+    for (int j = i; j < end; j++)
+    {
+        parallel.replace |= strstr(args[j], "{}") != NULL;
+    }
+    struct command_entry *entry = command_find(args[i]);
+    parallel.internal = entry && (entry->alias || entry->function ||
+                                  entry->builtin);
+
+    // Reads the inputs.
+    struct capture text = {NULL, 0, 0};
+    char *path = args[end + 1];
+    args[end] = NULL;
+    if (from_file)
+    {
+        if (parallel_inputs(path, &text, &parallel))
+        {
+            free(text.data);
+            return EXIT_FAILURE;
+        }
+    }
+    else
+    {
+        parallel.inputs = &args[end + 1];
+        while (parallel.inputs[parallel.n_inputs])
+        {
+            parallel.n_inputs++;
+        }
+    }
+    // Executes the jobs.
+    int result = EXIT_SUCCESS;
+    int n_jobs = parallel.n_inputs ? parallel.n_inputs : 1;
+    struct batch_job *jobs = malloc(sizeof(*jobs) * n_jobs);
+    if (!jobs)
+    {
+        perror("malloc");
+        result = EXIT_FAILURE;
+    }
+    else
+    {
+        struct batch batch = {jobs, parallel.n_inputs, slots, fail_fast, -1,
+                              parallel_launch, &parallel, NULL};
+        int executed = batch_run(&batch);
+
+        // Shows the inputs that failed and the summary.
+        int failed = 0;
+        for (int job = 0; job < executed; job++)
+        {
+            if (jobs[job].status)
+            {
+                fprintf(stderr, "parallel: %s: estado %d\n",
+                        parallel.inputs[job], jobs[job].status);
+                failed++;
+            }
+        }
+        if (failed || executed < parallel.n_inputs)
+        {
+            fprintf(stderr, "parallel: %d trabajos, %d con estado distinto de "
+                            "0, %d sin ejecutar\n", parallel.n_inputs, failed,
+                    parallel.n_inputs - executed);
+        }
+        result = ms->interrupted ? 130 : failed > 101 ? 101 : failed;
+    }
+    free(jobs);
+    if (from_file)
+    {
+        free(parallel.inputs);
+    }
+    free(text.data);
+    return result;
+}
+
+/*
+* Function: parallel_inputs:
+* --------------------------
+* Reads the inputs of parallel from a file, one for each line.
+*
+*  path: name of the file.
+*  text: buffer where the file is stored, it has to be freed.
+*  parallel: options where the inputs are stored, inputs has to be freed.
+*
+*  returns: exit success or exit failure if the file can not be read.
+*/
+int parallel_inputs(char *path, struct capture *text,
+                    struct parallel_options *parallel)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        fprintf(stderr, "parallel: %s: %s\n", path, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    int result = capture_read(fd, text) || capture_append(text, "", 1);
+    close(fd);
+    if (result)
+    {
+        return EXIT_FAILURE;
+    }
+    // Divides the lines, the last one can end without a new line.
+    int n = 0;
+    for (size_t i = 0; i + 1 < text->length; i++)
+    {
+        n += text->data[i] == '\n' || i + 2 == text->length;
+    }
+    parallel->inputs = malloc(sizeof(char *) * (n ? n : 1));
+    if (!parallel->inputs)
+    {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+    char *line = text->data;
+    for (parallel->n_inputs = 0; parallel->n_inputs < n; parallel->n_inputs++)
+    {
+        parallel->inputs[parallel->n_inputs] = line;
+        line = strchr(line, '\n');
+        if (line)
+        {
+            *line++ = '\0';
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: parallel_args:
+* ------------------------
+* Creates the tokens of the command of a job, replacing {} with the input.
+*
+*  parallel: options of parallel.
+*  input: input of the job.
+*  words: buffer where the tokens are stored separated by '\0'.
+*
+*  returns: the number of tokens or -1 if there are too many or there is no
+*           memory.
+*/
+int parallel_args(struct parallel_options *parallel, char *input,
+                  struct capture *words)
+{
+    int n = 0;
+    for (char **word = parallel->command; *word; word++, n++)
+    {
+        char *start = *word;
+        char *brace;
+        while ((brace = strstr(start, "{}")))
+        {
+            if (capture_append(words, start, brace - start) ||
+                capture_append(words, input, strlen(input)))
+            {
+                return -1;
+            }
+            start = brace + 2;
+        }
+        if (capture_append(words, start, strlen(start) + 1))
+        {
+            return -1;
+        }
+    }
+    if (!parallel->replace)
+    {
+        if (capture_append(words, input, strlen(input) + 1))
+        {
+            return -1;
+        }
+        n++;
+    }
+    if (n > ARGS_SIZE - 1)
+    {
+        fprintf(stderr, "parallel: demasiados argumentos, el máximo es %d\n",
+                ARGS_SIZE - 1);
+        return -1;
+    }
+    return n;
+}
+
+/*
+* Function: parallel_launch:
+* --------------------------
+* Launches the command of a job of parallel. The external commands are 
+* executed directly by the son and the others by a subshell.
+*
+*  batch: batch of parallel, data is the options of parallel.
+*  job: index of the input.
+*  options: options of the son given by the batch.
+*
+*  returns: the pid of the son or -1 if the command could not be created.
+*/
+pid_t parallel_launch(struct batch *batch, int job,
+                      struct launch_options *options)
+{
+    struct parallel_options *parallel = batch->data;
+    struct script_node node;
+    memset(&node, 0, sizeof(node));
+    node.type = NODE_COMMAND;
+    node.n_words = parallel_args(parallel, parallel->inputs[job], &node.words);
+    char *args[ARGS_SIZE];
+    char *text = node.n_words > 0 ? script_words(&node, args) : NULL;
+    if (!text)
+    {
+        free(node.words.data);
+        return -1;
+    }
+    char command[COMMAND_LINE_SIZE];
+    join_args(args, command);
+    if (parallel->internal)
+    {
+        options->script = &node;
+    }
+    pid_t pid = launch_job(args, command, 1, options);
+    free(text);
+    free(node.words.data);
+    return pid;
+}
+
+/*
+* Function: internal_mapchunks:
+* -----------------------------
+* Executes a command for each chunk of a file: mapchunks [-j N] fichero 
+* orden. The file is mapped with mmap and divided in N chunks (by default
+* the number of CPUs) that end at the end of a line. Each chunk is sent to 
+* the stdin of a job with vmsplice, without copying it, and the outputs are
+* written in the order of the chunks.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: the exit status of the first chunk that did not end with status
+*           0, 130 after Ctrl+C or exit failure if the command was not 
+*           correct.
+*/
+int internal_mapchunks(char **args)
+{
+    struct map_options map;
+    memset(&map, 0, sizeof(map));
+    int slots = sysconf(_SC_NPROCESSORS_ONLN);
+    int i = 1;
+    if (slots < 1)
+    {
+        slots = 1;
+    }
+    // Reads the number of chunks.
+    if (args[i] && !strcmp(args[i], "-j") && args[i + 1])
+    {
+        char *end;
+        slots = strtol(args[i + 1], &end, 10);
+        if (*end || slots < 1)
+        {
+            fprintf(stderr, "El número de trabajos debe ser mayor que 0.\n");
+            return EXIT_FAILURE;
+        }
+        i += 2;
+    }
+    if (!args[i] || !args[i + 1])
+    {
+        fprintf(stderr, "La sintaxis es errónea, mapchunks [-j N] fichero "
+                        "orden\n");
+        return EXIT_FAILURE;
+    }
+    // Maps the file.
+    int fd = open(args[i], O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info))
+    {
+        fprintf(stderr, "mapchunks: %s: %s\n", args[i], strerror(errno));
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        return EXIT_FAILURE;
+    }
+    size_t size = info.st_size;
+    char *data = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0)
+                      : NULL;
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        perror("mmap");
+        return EXIT_FAILURE;
+    }
+    if (size)
+    {
+        madvise(data, size, MADV_SEQUENTIAL);
+    }
+    // Divides the file and prepares the command.
+    map.command = &args[i + 1];
+    map.n_chunks = slots;
+    map.chunks = malloc(sizeof(struct map_chunk) * slots);
+    struct batch_job *jobs = malloc(sizeof(struct batch_job) * slots);
+    struct command_entry *entry = command_find(map.command[0]);
+    struct script_node node;
+    memset(&node, 0, sizeof(node));
+    node.type = NODE_COMMAND;
+    int result = !map.chunks || !jobs;
+    if (result)
+    {
+        perror("malloc");
+    }
+    else if (entry && (entry->alias || entry->function || entry->builtin))
+    {
+        for (char **word = map.command; *word && !result; word++)
+        {
+            result = capture_append(&node.words, *word, strlen(*word) + 1);
+            node.n_words++;
+        }
+        map.script = &node;
+    }
+    if (!result)
+    {
+        mapchunks_split(data, size, &map);
+
+        // The jobs that end before reading their chunk do not stop the 
+        // minishell.
+        void (*handler)(int) = signal(SIGPIPE, SIG_IGN);
+        struct batch batch = {jobs, map.n_chunks, map.n_chunks, 0, -1,
+                              mapchunks_launch, &map, mapchunks_feed};
+        batch_run(&batch);
+        signal(SIGPIPE, handler);
+        for (int chunk = 0; chunk < map.n_chunks; chunk++)
+        {
+            mapchunks_close(&map.chunks[chunk]);
+        }
+        for (int job = 0; job < map.n_chunks && !result; job++)
+        {
+            result = jobs[job].status;
+        }
+        if (ms->interrupted)
+        {
+            result = 130;
+        }
+    }
+    free(node.words.data);
+    free(jobs);
+    free(map.chunks);
+    if (size)
+    {
+        munmap(data, size);
+    }
+    return result;
+}
+
+/*
+* Function: mapchunks_split:
+* --------------------------
+* Divides a file in chunks of the same size that end at the end of a line.
+* The chunks that would be empty because of long lines are not used.
+*
+*  data: mapping of the file.
+*  size: size of the file.
+*  map: options of mapchunks, n_chunks is the maximum number of chunks and 
+*       it is updated.
+*
+*  returns: the number of chunks.
+*/
+int mapchunks_split(char *data, size_t size, struct map_options *map)
+{
+    size_t start = 0;
+    int n = 0;
+    for (int chunk = 1; chunk <= map->n_chunks; chunk++)
+    {
+        // The chunk ends after the first new line from its size.
+        size_t end = chunk == map->n_chunks ? size
+                                            : size / map->n_chunks * chunk;
+        if (end < start)
+        {
+            end = start;
+        }
+        if (end > 0 && end < size && data[end - 1] != '\n')
+        {
+            char *newline = memchr(data + end, '\n', size - end);
+            end = newline ? (size_t)(newline - data) + 1 : size;
+        }
+        // An empty file has an empty chunk.
+        if (end > start || (!n && chunk == map->n_chunks))
+        {
+            map->chunks[n].data = data + start;
+            map->chunks[n].length = end - start;
+            map->chunks[n].fd = -1;
+            n++;
+            start = end;
+        }
+    }
+    map->n_chunks = n;
+    return n;
+}
+
+/*
+* Function: mapchunks_launch:
+* ---------------------------
+* Launches the command of a chunk with a pipe as stdin. The write end of the
+* pipe does not block and it is added to the event loop, so the minishell 
+* wakes up when it can send more data.
+*
+*  batch: batch of mapchunks, data is the options of mapchunks.
+*  job: index of the chunk.
+*  options: options of the son given by the batch.
+*
+*  returns: the pid of the son or -1 if the pipe could not be created.
+*/
+pid_t mapchunks_launch(struct batch *batch, int job,
+                       struct launch_options *options)
+{
+    struct map_options *map = batch->data;
+    struct map_chunk *chunk = &map->chunks[job];
+    int pipe_fd[2];
+    if (pipe2(pipe_fd, O_CLOEXEC))
+    {
+        perror("pipe");
+        return -1;
+    }
+    // Bigger pipes need less wake ups, the size is not required.
+    fcntl(pipe_fd[1], F_SETPIPE_SZ, 1 << 20);
+    fcntl(pipe_fd[1], F_SETFL, O_NONBLOCK);
+    options->has_input = 1;
+    options->input = pipe_fd[0];
+    options->script = map->script;
+
+    char command[COMMAND_LINE_SIZE];
+    join_args(map->command, command);
+    pid_t pid = launch_job(map->command, command, 1, options);
+    close(pipe_fd[0]);
+    chunk->fd = pipe_fd[1];
+
+    // Only the write ends of the chunks are watched, the event loop does 
+    // not read them.
+    struct epoll_event event;
+    event.events = EPOLLOUT;
+    event.data.fd = chunk->fd;
+    epoll_ctl(ms->event_fd, EPOLL_CTL_ADD, chunk->fd, &event);
+    if (!chunk->length)
+    {
+        mapchunks_close(chunk);
+    }
+    return pid;
+}
+
+/*
+* Function: mapchunks_feed:
+* -------------------------
+* Sends to each job the part of its chunk that fits in its pipe. The pages 
+* of the mapping are given to the pipe with vmsplice; if it can not be used
+* they are copied with write. The pipe is closed when the whole chunk has 
+* been sent or the job has finished.
+*
+*  batch: batch of mapchunks, data is the options of mapchunks.
+*
+*  returns: the number of chunks that have not been sent yet.
+*/
+int mapchunks_feed(struct batch *batch)
+{
+    struct map_options *map = batch->data;
+    int pending = 0;
+    for (int job = 0; job < map->n_chunks; job++)
+    {
+        struct map_chunk *chunk = &map->chunks[job];
+        while (chunk->fd >= 0 && chunk->length)
+        {
+            struct iovec iov = {chunk->data, chunk->length};
+            ssize_t n = vmsplice(chunk->fd, &iov, 1, SPLICE_F_NONBLOCK);
+            if (n < 0 && (errno == EINVAL || errno == ENOSYS))
+            {
+                n = write(chunk->fd, chunk->data, chunk->length);
+            }
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n < 0 && errno == EAGAIN)
+            {
+                break;
+            }
+            if (n <= 0)
+            {
+                // The job has closed its stdin.
+                chunk->length = 0;
+                break;
+            }
+            chunk->data += n;
+            chunk->length -= n;
+        }
+        if (chunk->fd >= 0 && !chunk->length)
+        {
+            mapchunks_close(chunk);
+        }
+        pending += chunk->fd >= 0;
+    }
+    return pending;
+}
+
+/*
+* Function: mapchunks_close:
+* --------------------------
+* Removes the pipe of a chunk from the event loop and closes it, so the job
+* reads the end of file.
+*
+*  chunk: chunk of mapchunks.
+*
+*  returns: void.
+*/
+void mapchunks_close(struct map_chunk *chunk)
+{
+    if (chunk->fd >= 0)
+    {
+        epoll_ctl(ms->event_fd, EPOLL_CTL_DEL, chunk->fd, NULL);
+        close(chunk->fd);
+        chunk->fd = -1;
+    }
+}
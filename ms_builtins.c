@@ -0,0 +1,713 @@
+/*
+* Internal commands of libminishell that do not manage jobs: cd, export, 
+* source, exit, exec, timeout and ulimit.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#include "ms_internal.h"
+
+// Limits that can be changed with ulimit.
+static const struct limit_info limits_info[N_LIMITS] = {
+    {'c', RLIMIT_CORE, 1024, "tamaño del core (KB)"},
+    {'n', RLIMIT_NOFILE, 1, "ficheros abiertos"},
+    {'t', RLIMIT_CPU, 1, "tiempo de CPU (segundos)"},
+    {'u', RLIMIT_NPROC, 1, "procesos de usuario"},
+    {'v', RLIMIT_AS, 1024, "memoria virtual (KB)"}};
+
+/*
+* Function: internal_cd:
+* ----------------------
+* Changes the working directory for the one introduced as parameter. If there 
+* are no arguments introduced it will go to the user home. Also it will accept 
+* directories with blank spaces thanks to the auxiliary function.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: exit success or exit failure if an error happened.
+*/
+int internal_cd(char **args)
+{
+    // Checks if there was an argument, if not, goes to the HOME.
+    if (args[1])
+    {
+        // Allocates memory for the path introduced as argument.
+        char *path = (char *)malloc(sizeof(char) * COMMAND_LINE_SIZE);
+
+        // Copies the first argument to the path.
+        strcpy(path, args[1]);
+
+        // Creates the path adding blanks.
+        for (int i = 2; i < ARGS_SIZE && args[i] != NULL; i++)
+        {
+            strcat(path, " ");
+            strcat(path, args[i]);
+        }
+        /* Checks if there are directories or files with blanks in their name
+           and removes the special character defining the blank spaces. */
+        aux_internal_cd(path, '\"');
+        aux_internal_cd(path, '\'');
+        aux_internal_cd(path, '\\');
+
+        // Changes the working directory and checks if it was successful.
+        if (chdir(path))
+        {
+            // Prints the error in stderr.
+            perror("chdir");
+            return EXIT_FAILURE;
+        }
+        // Liberates memory used by the path.
+        free(path);
+    }
+    else
+    {
+        // Changes the working directory and checks if it was successful.
+        if (chdir(getenv("HOME")))
+        {
+            // Prints the error in stderr.
+            perror("chdir");
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: aux_internal_cd:
+* --------------------------
+* Checks if there are blank spaces identified with the character c and if so, 
+* it unifies the path and elimintates all characters c from the path.
+*
+*  path: pointer to the string char used to store the path.
+*  c: char that must be eliminated from the path.
+*
+*  returns: exit success or exit failure.
+*/
+int aux_internal_cd(char *path, char c)
+{
+    // Checks if there is any character c in the path.
+    if (strchr(path, c))
+    {
+        // Allocates memory for an auxiliar variable for the path.
+        char *auxpath = (char *)malloc(sizeof(char) * COMMAND_LINE_SIZE);
+
+        // Gets the first part of the path without the character c.
+        char *aux = strtok(path, &c);
+
+        // Cleans the auxiliary path.
+        strcpy(auxpath, "");
+
+        // While there are characters c in the string path.
+        while (aux)
+        {
+            // Adds aux to the new path and gets the next part of it.
+            strcat(auxpath, aux);
+            aux = strtok(NULL, &c);
+        }
+        // Copies the content of auxpath into the path and eliminates it.
+        strcpy(path, auxpath);
+        free(auxpath);
+        return EXIT_SUCCESS;
+    }
+    return EXIT_FAILURE;
+}
+
+/*
+* Function: internal_export:
+* --------------------------
+* Changes an env variable indicated in the args with the new value.
+*  
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: exit success or exit failure if the input was not introduced 
+*           correctly.
+*/
+int internal_export(char **args)
+{
+    // Checks if it has the arguments correctly.
+    if (args[1] && !args[2])
+    {
+        // Divides the arg 1 using the = as separator.
+        strtok(args[1], "=");
+        char *token = strtok(NULL, "=");
+
+        // Checks if the estructure NAME=value was introduced correctly.
+        if (args[1] && token)
+        {
+            // Changes the values of the env variable.
+            setenv(args[1], token, 1);
+            return EXIT_SUCCESS;
+        }
+    }
+    fprintf(stderr, "Error de sintaxis. Uso: export Nombre=Valor\n");
+    return EXIT_FAILURE;
+}
+
+/*
+* Function: internal_source:
+* --------------------------
+* Allows the execution of multiple predefined commands contained in a script
+* file. The scripts can use if, while, until, for, case and { ...; }. With
+* source -j N fichero up to N commands of the script are executed at the 
+* same time. With source --profile [-o pilas] fichero the lines of the 
+* script are measured and a report is printed at the end, or the collapsed
+* stacks for the flame graphs are written in the file pilas.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: exit success or exit failure if an error with the file happens.
+*/
+int internal_source(char **args)
+{
+    int slots = 0;
+    int profile = 0;
+    char *output = NULL;
+    int i = 1;
+
+    // Reads the number of commands executed at the same time and the 
+    // options of the profile.
+    while (args[i] && args[i + 1])
+    {
+        if (!strcmp(args[i], "-j"))
+        {
+            char *end;
+            slots = strtol(args[i + 1], &end, 10);
+            if (*end || slots < 1)
+            {
+                fprintf(stderr, "El número de trabajos debe ser mayor que "
+                                "0.\n");
+                return EXIT_FAILURE;
+            }
+            i += 2;
+        }
+        else if (!strcmp(args[i], "--profile"))
+        {
+            profile = 1;
+            i++;
+        }
+        else if (!strcmp(args[i], "-o"))
+        {
+            output = args[i + 1];
+            i += 2;
+        }
+        else
+        {
+            break;
+        }
+    }
+    // The commands executed at the same time can not be measured by line.
+    if (!args[i] || args[i + 1] || (output && !profile) || (profile && slots))
+    {
+        fprintf(stderr, "La sintaxis es errónea, source [-j N | --profile "
+                        "[-o fichero]] fichero\n");
+        return EXIT_FAILURE;
+    }
+    return profile ? profile_source(args[i], output) :
+           source_file(args[i], slots);
+}
+
+/*
+* Function: source_file:
+* ----------------------
+* Reads a script file, compiles it and executes it. The script is only
+* executed if it does not have syntax errors.
+*
+*  path: name of the script file.
+*  slots: number of commands executed at the same time, 0 to execute them 
+*         one after the other.
+*
+*  returns: the exit status of the last command or exit failure if an error 
+*           with the file happens.
+*/
+int source_file(char *path, int slots)
+{
+    // Open a file in reading mode.
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        // If there was a problem, it is notified.
+        fprintf(stderr, "El archivo no existe o no se puede abrir.\n");
+        return EXIT_FAILURE;
+    }
+    // Reads the whole file and executes it.
+    struct capture text = {NULL, 0, 0};
+    int result = capture_read(fd, &text) || capture_append(&text, "", 1);
+    close(fd);
+    if (!result)
+    {
+        result = source_text(path, text.data, slots);
+    }
+    free(text.data);
+    return result;
+}
+
+/*
+* Function: source_text:
+* ----------------------
+* Compiles the text of a script and executes it if it does not have syntax
+* errors. If the minishell allows it (exec_last), the last command of the 
+* main script replaces the minishell.
+*
+*  path: name of the script, used in the errors.
+*  text: text of the script ended with '\0'.
+*  slots: number of commands executed at the same time, 0 to execute them 
+*         one after the other.
+*
+*  returns: the exit status of the last command or exit failure if the 
+*           script has syntax errors.
+*/
+int source_text(const char *path, char *text, int slots)
+{
+    struct script_node *script = script_compile(path, text);
+    if (!script)
+    {
+        return EXIT_FAILURE;
+    }
+    // Ctrl+C only stops the scripts started after it. A profiled script is
+    // not replaced by its last command, the profile would be lost.
+    struct script_node *exec_script = ms->exec_script;
+    if (!ms->source_depth)
+    {
+        ms->interrupted = 0;
+        if (ms->exec_last && !slots && !ms->profile)
+        {
+            ms->exec_script = script;
+        }
+    }
+    ms->source_depth++;
+
+    // The lines of the profile are identified by the script.
+    const char *profile_path = NULL;
+    if (ms->profile)
+    {
+        profile_path = ms->profile->path;
+        ms->profile->path = path;
+    }
+
+    // Executes the commands and notifies the background jobs finished 
+    // after each one.
+    int result = slots ? batch_source(script, slots) : script_run(script, 1);
+    if (ms->profile)
+    {
+        ms->profile->path = profile_path;
+    }
+    ms->source_depth--;
+    ms->exec_script = exec_script;
+    script_free(script);
+    return result;
+}
+
+/*
+* Function: internal_exit:
+* ------------------------
+* Exits the minishell after launching the queued jobs and ending the profile
+* of a script executed with source --profile.
+*
+*  args: pointer array that storages all the tokens in a command line, the
+*        optional argument is the exit status.
+*
+*  returns: it does not return.
+*/
+int internal_exit(char **args)
+{
+    queue_drain();
+    profile_finish();
+    exit(args[1] ? atoi(args[1]) : ms->last_status);
+}
+
+/*
+* Function: internal_exec:
+* ------------------------
+* Replaces the minishell with a command after launching the queued jobs: 
+* exec orden [argumentos] [> fichero]. Without a command, the redirections 
+* are applied to the minishell and kept for the next commands: N>fichero, 
+* N>>fichero, N<fichero, N>&M and N>&- (closes N), where N and M are 
+* descriptors from 0 to 9. The sons receive the descriptors above stderr 
+* opened with exec.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: exit success or exit failure if a redirection could not be 
+*           applied or the command could not be executed.
+*/
+int internal_exec(char **args)
+{
+    // Executes the command.
+    char *ptr = args[1];
+    if (ptr && isdigit((unsigned char)*ptr))
+    {
+        ptr++;
+    }
+    if (ptr && *ptr != '>' && *ptr != '<')
+    {
+        queue_drain();
+        return exec_command(args + 1);
+    }
+    // Applies the redirections.
+    for (int i = 1; args[i];)
+    {
+        int used = exec_redirection(args + i);
+        if (used < 0)
+        {
+            return EXIT_FAILURE;
+        }
+        i += used;
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: exec_redirection:
+* ---------------------------
+* Applies a redirection of exec to the minishell. The file can be in the 
+* same token or in the next one. The descriptors above stderr are added to 
+* the keep list, so the sons receive them, and removed when they are closed.
+*
+*  args: pointer array with the redirection and the next tokens.
+*
+*  returns: the number of tokens used or -1 if there is an error.
+*/
+int exec_redirection(char **args)
+{
+    char *ptr = args[0];
+    int used = 1;
+
+    // Reads the descriptor and the operator.
+    int fd = isdigit((unsigned char)*ptr) ? *ptr++ - '0' : -1;
+    int flags = O_RDONLY;
+    if (*ptr == '>')
+    {
+        flags = ptr[1] == '>' ? O_WRONLY | O_CREAT | O_APPEND :
+                                O_WRONLY | O_CREAT | O_TRUNC;
+        ptr += ptr[1] == '>' ? 2 : 1;
+    }
+    else if (*ptr == '<')
+    {
+        ptr++;
+    }
+    else
+    {
+        fprintf(stderr, "exec: %s: redirección no válida\n", args[0]);
+        return -1;
+    }
+    if (fd < 0)
+    {
+        fd = flags == O_RDONLY ? 0 : 1;
+    }
+    // Opens the file or finds the descriptor to duplicate.
+    int target = -1;
+    int opened = 0;
+    if (*ptr == '&')
+    {
+        ptr++;
+        if (strcmp(ptr, "-") && (!isdigit((unsigned char)*ptr) || ptr[1]))
+        {
+            fprintf(stderr, "exec: %s: redirección no válida\n", args[0]);
+            return -1;
+        }
+        target = *ptr == '-' ? -1 : *ptr - '0';
+        if (target >= 0 && fcntl(target, F_GETFD) < 0)
+        {
+            fprintf(stderr, "exec: %d: descriptor no válido\n", target);
+            return -1;
+        }
+    }
+    else
+    {
+        if (!*ptr && !args[1])
+        {
+            fprintf(stderr, "exec: %s: falta el fichero\n", args[0]);
+            return -1;
+        }
+        if (!*ptr)
+        {
+            ptr = args[1];
+            used = 2;
+        }
+        target = open(ptr, flags | O_CLOEXEC, S_IRUSR | S_IWUSR);
+        if (target < 0)
+        {
+            perror(ptr);
+            return -1;
+        }
+        opened = 1;
+    }
+    // Replaces the descriptor, the output written before goes to the old 
+    // file. The sons of the pool have the old descriptors.
+    fflush(stdout);
+    fflush(stderr);
+    pool_flush();
+    if (target < 0)
+    {
+        close(fd);
+    }
+    else if (target == fd)
+    {
+        fcntl(fd, F_SETFD, 0);
+    }
+    else
+    {
+        dup2(target, fd);
+        if (opened)
+        {
+            close(target);
+        }
+    }
+    // Updates the keep list.
+    if (target < 0)
+    {
+        keep_fd_remove(fd);
+    }
+    else
+    {
+        keep_fd_add(fd);
+    }
+    return used;
+}
+
+/*
+* Function: internal_timeout:
+* ---------------------------
+* Executes a command and sends it a signal if it is still running when the 
+* duration expires. The syntax is: timeout [-s SIG] [-k KILL_AFTER] DURATION 
+* command, the options can also be written after the duration. Durations 
+* accept the suffixes s, m, h and d. All the timeouts share the same timerfd.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: the exit status of a foreground command, 124 if its timeout has
+*           expired, exit success for a background command or exit failure 
+*           if the command was not correct.
+*/
+int internal_timeout(char **args)
+{
+    long long duration = -1;
+    long long kill_after = 0;
+    int sig = SIGTERM;
+
+    // Reads the options and the duration.
+    int i = 1;
+    while (args[i])
+    {
+        if (!strcmp(args[i], "-s") && args[i + 1])
+        {
+            sig = signal_number(args[i + 1]);
+            if (sig < 0)
+            {
+                fprintf(stderr, "Señal no válida: %s\n", args[i + 1]);
+                return EXIT_FAILURE;
+            }
+            i += 2;
+        }
+        else if (!strcmp(args[i], "-k") && args[i + 1])
+        {
+            kill_after = parse_duration(args[i + 1]);
+            if (kill_after < 0)
+            {
+                fprintf(stderr, "Duración no válida: %s\n", args[i + 1]);
+                return EXIT_FAILURE;
+            }
+            i += 2;
+        }
+        else if (duration < 0)
+        {
+            duration = parse_duration(args[i]);
+            if (duration < 0)
+            {
+                fprintf(stderr, "Duración no válida: %s\n", args[i]);
+                return EXIT_FAILURE;
+            }
+            i++;
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (duration < 0 || !args[i])
+    {
+        fprintf(stderr, "La sintaxis es errónea, timeout [-s señal] "
+                        "[-k duración] duración orden\n");
+        return EXIT_FAILURE;
+    }
+    // Launches the command and programs the timeout (0 means no timeout).
+    int bkg;
+    ms->timed_out = 0;
+    pid_t pid = launch_prefixed(args, &args[i], NULL, &bkg);
+    if (pid > 0)
+    {
+        if (duration > 0)
+        {
+            timer_add(pid, monotonic_ns() + duration, sig, kill_after);
+        }
+        if (!bkg)
+        {
+            // Like timeout of coreutils, a command ended by its timeout 
+            // returns 124, except if it has been killed with SIGKILL.
+            char *command = ms->jobs_list[FOREGROUND].command_line;
+            int status = wait_foreground(command);
+            if (status == 128 + SIGTSTP)
+            {
+                return status;
+            }
+            timer_cancel(pid);
+            if (ms->timed_out == pid && status != 128 + SIGKILL)
+            {
+                status = 124;
+            }
+            ms->timed_out = 0;
+            return status;
+        }
+        return EXIT_SUCCESS;
+    }
+    return EXIT_FAILURE;
+}
+
+/*
+* Function: internal_ulimit:
+* --------------------------
+* Shows or changes the limits of the minishell, or executes a command with 
+* other limits if a command is written after the options, for example 
+* "ulimit -v 1048576 -t 60 orden &". The options are -c (core), -n (open 
+* files), -t (CPU seconds), -u (processes) and -v (virtual memory), -a shows
+* all the limits and -S or -H change only the soft or the hard limit.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: exit success or exit failure if a limit could not be changed or
+*           the command was not correct.
+*/
+int internal_ulimit(char **args)
+{
+    struct launch_options options;
+    int queries[N_LIMITS];
+    int n_queries = 0;
+    memset(&options, 0, sizeof(options));
+    options.soft = 1;
+    options.hard = 1;
+
+    // Reads the options, each one can be followed by a value.
+    int i = 1;
+    while (args[i] && args[i][0] == '-' && args[i][1] && !args[i][2])
+    {
+        char option = args[i][1];
+        i++;
+        if (option == 'S' || option == 'H')
+        {
+            options.soft = option == 'S';
+            options.hard = option == 'H';
+            continue;
+        }
+        else if (option == 'a')
+        {
+            for (int j = 0; j < N_LIMITS; j++)
+            {
+                queries[n_queries++ % N_LIMITS] = j;
+            }
+            continue;
+        }
+        // Searches the limit of the option.
+        int limit = 0;
+        while (limit < N_LIMITS && limits_info[limit].option != option)
+        {
+            limit++;
+        }
+        if (limit == N_LIMITS)
+        {
+            fprintf(stderr, "Opción no válida: -%c\n", option);
+            return EXIT_FAILURE;
+        }
+        // Reads the value if there is one, otherwise it is a query.
+        char *end = NULL;
+        rlim_t value = 0;
+        if (args[i] && !strcmp(args[i], "unlimited"))
+        {
+            value = RLIM_INFINITY;
+        }
+        else if (args[i] && args[i][0] >= '0' && args[i][0] <= '9')
+        {
+            value = strtoull(args[i], &end, 10) * limits_info[limit].unit;
+            if (*end)
+            {
+                fprintf(stderr, "Valor no válido: %s\n", args[i]);
+                return EXIT_FAILURE;
+            }
+        }
+        else
+        {
+            queries[n_queries++ % N_LIMITS] = limit;
+            continue;
+        }
+        i++;
+        if (options.n_limits == N_LIMITS)
+        {
+            fprintf(stderr, "Demasiados límites.\n");
+            return EXIT_FAILURE;
+        }
+        options.resources[options.n_limits] = limits_info[limit].resource;
+        options.values[options.n_limits] = value;
+        options.n_limits++;
+    }
+    if (n_queries > N_LIMITS)
+    {
+        n_queries = N_LIMITS;
+    }
+    // If there is a command, it is executed with the limits.
+    if (args[i])
+    {
+        if (n_queries || !options.n_limits)
+        {
+            fprintf(stderr, "La sintaxis es errónea, ulimit -opción valor "
+                            "orden\n");
+            return EXIT_FAILURE;
+        }
+        int bkg;
+        pid_t pid = launch_prefixed(args, &args[i], &options, &bkg);
+        if (pid > 0 && !bkg)
+        {
+            return wait_foreground(ms->jobs_list[FOREGROUND].command_line);
+        }
+        return pid > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    // Changes the limits of the minishell, the sons of the pool have the
+    // old ones.
+    if (options.n_limits)
+    {
+        pool_flush();
+    }
+    if (apply_launch_options(&options))
+    {
+        return EXIT_FAILURE;
+    }
+    // Without options all the limits are shown.
+    if (!n_queries && !options.n_limits)
+    {
+        for (n_queries = 0; n_queries < N_LIMITS; n_queries++)
+        {
+            queries[n_queries] = n_queries;
+        }
+    }
+    // Prints the queried limits.
+    for (int j = 0; j < n_queries; j++)
+    {
+        struct rlimit limit;
+        const struct limit_info *info = &limits_info[queries[j]];
+        getrlimit(info->resource, &limit);
+        rlim_t value = options.hard && !options.soft ? limit.rlim_max
+                                                     : limit.rlim_cur;
+        if (value == RLIM_INFINITY)
+        {
+            printf("-%c %-26s unlimited\n", info->option, info->name);
+        }
+        else
+        {
+            printf("-%c %-26s %llu\n", info->option, info->name,
+                   (unsigned long long)(value / info->unit));
+        }
+    }
+    return EXIT_SUCCESS;
+}
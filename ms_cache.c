@@ -0,0 +1,440 @@
+/*
+* Cache of outputs of libminishell: the internal command cache stores the
+* output and the exit status of a command in a directory, with the name of
+* the entry obtained from a hash of the command, some environment variables
+* and the modification time of some files. The next executions of the same
+* command are replayed from the entry without creating a son.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#include "ms_internal.h"
+
+// Environment variables that are always part of the key.
+static const char *cache_env[] = {"PATH", "LANG", "LC_ALL", NULL};
+
+/*
+* Function: internal_cache:
+* -------------------------
+* Executes a command with cache: cache [--ttl DURATION] [--env VAR]...
+* [--key-files FILE... --] command. If there is a valid entry for the command
+* its output is sent to stdout with sendfile and its status is returned
+* without executing it. Otherwise the command is executed and its output and
+* status are stored, except if it ended by a signal.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: the exit status of the command or exit failure if the syntax is
+*           not correct.
+*/
+int internal_cache(char **args)
+{
+    struct cache_options options;
+    if (cache_options(args, &options))
+    {
+        fprintf(stderr, "Error de sintaxis. Uso: cache [--ttl duración] "
+                "[--env VAR]... [--key-files fichero... --] orden\n");
+        return EXIT_FAILURE;
+    }
+    // Looks for the entry of the command.
+    char path[COMMAND_LINE_SIZE];
+    struct capture key = {NULL, 0, 0};
+    int cached = !cache_key(&options, &key) && !cache_path(&key, path);
+    trace_event('B', "cache", options.command[0], 0);
+    int replayed = cached ? cache_replay(path, &key, options.ttl)
+                          : EXIT_FAILURE;
+    if (replayed != EXIT_FAILURE)
+    {
+        // The command is not executed again if part of its output was sent.
+        trace_event('E', "cache", options.command[0], 1);
+        free(key.data);
+        return replayed ? EXIT_FAILURE : ms->last_status;
+    }
+    // Executes the command and shows its output.
+    struct capture output = {NULL, 0, 0};
+    int result = is_internal(options.command[0]) ?
+                 capture_internal(options.command, &output) :
+                 capture_son(options.command, NULL, &output);
+    int status = result ? EXIT_FAILURE : ms->last_status;
+    fflush(stdout);
+    for (size_t written = 0; written < output.length;)
+    {
+        ssize_t n = write(1, output.data + written, output.length - written);
+        if (n < 0 && errno != EINTR)
+        {
+            break;
+        }
+        written += n > 0 ? n : 0;
+    }
+    // The commands killed by a signal are not stored.
+    if (cached && !result && status < 128)
+    {
+        cache_store(path, &key, &output, status);
+    }
+    trace_event('E', "cache", options.command[0], 0);
+    free(output.data);
+    free(key.data);
+    return status;
+}
+
+/*
+* Function: cache_options:
+* ------------------------
+* Reads the options of cache.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*  options: pointer where the options are stored.
+*
+*  returns: exit success or exit failure if the options are not correct.
+*/
+int cache_options(char **args, struct cache_options *options)
+{
+    memset(options, 0, sizeof(struct cache_options));
+    options->ttl = -1;
+    int i = 1;
+    while (args[i] && !strncmp(args[i], "--", 2))
+    {
+        if (!strcmp(args[i], "--"))
+        {
+            i++;
+            break;
+        }
+        else if (!strcmp(args[i], "--ttl") && args[i + 1])
+        {
+            options->ttl = parse_duration(args[i + 1]);
+            if (options->ttl < 0)
+            {
+                return EXIT_FAILURE;
+            }
+            i += 2;
+        }
+        else if (!strcmp(args[i], "--env") && args[i + 1] &&
+                 options->n_env < CACHE_ENV)
+        {
+            options->env[options->n_env++] = args[i + 1];
+            i += 2;
+        }
+        else if (!strcmp(args[i], "--key-files"))
+        {
+            // The files end with the next option or "--".
+            for (i++; args[i] && strncmp(args[i], "--", 2); i++)
+            {
+                if (options->n_key_files == CACHE_KEY_FILES)
+                {
+                    return EXIT_FAILURE;
+                }
+                options->key_files[options->n_key_files++] = args[i];
+            }
+        }
+        else
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    options->command = args + i;
+    return args[i] ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+* Function: cache_key:
+* --------------------
+* Creates the key of a command: its tokens, the working directory, the
+* environment variables and the modification time, size and inode of the key
+* files.
+*
+*  options: options of cache.
+*  key: buffer where the key is stored.
+*
+*  returns: exit success or exit failure if there is no memory.
+*/
+int cache_key(struct cache_options *options, struct capture *key)
+{
+    char text[COMMAND_LINE_SIZE];
+    int result = EXIT_SUCCESS;
+
+    // Tokens of the command and working directory.
+    for (int i = 0; options->command[i]; i++)
+    {
+        result |= capture_append(key, options->command[i],
+                                 strlen(options->command[i]) + 1);
+    }
+    if (!getcwd(text, sizeof(text)))
+    {
+        text[0] = '\0';
+    }
+    result |= capture_append(key, text, strlen(text) + 1);
+
+    // Environment variables, the fixed ones and the ones of the options.
+    const char *names[CACHE_ENV + 4];
+    int n_names = 0;
+    for (int i = 0; cache_env[i]; i++)
+    {
+        names[n_names++] = cache_env[i];
+    }
+    for (int i = 0; i < options->n_env; i++)
+    {
+        names[n_names++] = options->env[i];
+    }
+    for (int i = 0; i < n_names; i++)
+    {
+        snprintf(text, sizeof(text), "%s=%s", names[i], getenv(names[i]) ?
+                 getenv(names[i]) : "");
+        result |= capture_append(key, text, strlen(text) + 1);
+    }
+    // Key files, a file that does not exist is also part of the key.
+    for (int i = 0; i < options->n_key_files; i++)
+    {
+        struct stat info;
+        if (stat(options->key_files[i], &info))
+        {
+            snprintf(text, sizeof(text), "%s:-", options->key_files[i]);
+        }
+        else
+        {
+            snprintf(text, sizeof(text), "%s:%lld.%09ld:%lld:%llu",
+                     options->key_files[i], (long long)info.st_mtim.tv_sec,
+                     info.st_mtim.tv_nsec, (long long)info.st_size,
+                     (unsigned long long)info.st_ino);
+        }
+        result |= capture_append(key, text, strlen(text) + 1);
+    }
+    return result;
+}
+
+/*
+* Function: cache_path:
+* ---------------------
+* Obtains the path of the entry of a key: the directory of the cache
+* ($MS_CACHE_DIR, $XDG_CACHE_HOME/minishell or ~/.cache/minishell) and the
+* 128 bits hash of the key (two FNV-1a of 64 bits). The directory is created
+* if it does not exist.
+*
+*  key: key of the command.
+*  path: pointer where the path of COMMAND_LINE_SIZE is stored.
+*
+*  returns: exit success or exit failure if there is no directory.
+*/
+int cache_path(struct capture *key, char *path)
+{
+    // Chooses the directory.
+    int length;
+    if (getenv("MS_CACHE_DIR"))
+    {
+        length = snprintf(path, COMMAND_LINE_SIZE, "%s",
+                          getenv("MS_CACHE_DIR"));
+    }
+    else if (getenv("XDG_CACHE_HOME"))
+    {
+        length = snprintf(path, COMMAND_LINE_SIZE, "%s/minishell",
+                          getenv("XDG_CACHE_HOME"));
+    }
+    else if (getenv("HOME"))
+    {
+        length = snprintf(path, COMMAND_LINE_SIZE, "%s/.cache/minishell",
+                          getenv("HOME"));
+    }
+    else
+    {
+        return EXIT_FAILURE;
+    }
+    if (length <= 0 || length > COMMAND_LINE_SIZE - 40)
+    {
+        return EXIT_FAILURE;
+    }
+    // Creates the directory and its parents.
+    for (char *ptr = path + 1; ; ptr++)
+    {
+        if (*ptr == '/' || !*ptr)
+        {
+            char c = *ptr;
+            *ptr = '\0';
+            if (mkdir(path, S_IRWXU) && errno != EEXIST)
+            {
+                perror("mkdir");
+                return EXIT_FAILURE;
+            }
+            *ptr = c;
+        }
+        if (!*ptr)
+        {
+            break;
+        }
+    }
+    // Adds the hash of the key.
+    uint64_t hashes[2] = {14695981039346656037ULL, 0x84222325cbf29ce4ULL};
+    for (size_t i = 0; i < key->length; i++)
+    {
+        hashes[0] = (hashes[0] ^ (unsigned char)key->data[i]) *
+                    1099511628211ULL;
+        hashes[1] = (hashes[1] ^ (unsigned char)key->data[i]) *
+                    1099511628211ULL;
+    }
+    snprintf(path + length, COMMAND_LINE_SIZE - length, "/%016llx%016llx",
+             (unsigned long long)hashes[0], (unsigned long long)hashes[1]);
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: cache_replay:
+* -----------------------
+* Sends the output of an entry to stdout and saves its status in
+* last_status, if the entry exists, has the same key and has not expired.
+*
+*  path: path of the entry.
+*  key: key of the command.
+*  ttl: nanoseconds that the entry is valid, -1 if it does not expire.
+*
+*  returns: exit success if the entry has been replayed, exit failure if it
+*           has not been used or -1 if the output could only be sent in 
+*           part.
+*/
+int cache_replay(char *path, struct capture *key, long long ttl)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return EXIT_FAILURE;
+    }
+    // Checks the header, the key and the time.
+    struct cache_header header;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    long long now_ns = now.tv_sec * 1000000000LL + now.tv_nsec;
+    char *stored = malloc(key->length ? key->length : 1);
+    int valid = stored &&
+                read(fd, &header, sizeof(header)) == sizeof(header) &&
+                !memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) &&
+                header.key_length == key->length &&
+                read(fd, stored, key->length) == (ssize_t)key->length &&
+                !memcmp(stored, key->data, key->length) &&
+                (ttl < 0 || now_ns - header.created <= ttl);
+    free(stored);
+
+    // Sends the output.
+    int result = valid ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (valid)
+    {
+        fflush(stdout);
+        uint64_t sent = 0;
+        if (cache_send(1, fd, sizeof(header) + header.key_length,
+                       header.output_length, &sent))
+        {
+            result = sent ? -1 : EXIT_FAILURE;
+        }
+        if (result < 0)
+        {
+            fprintf(stderr, "cache: no se ha podido enviar toda la salida "
+                    "de %s\n", path);
+        }
+        ms->last_status = header.status;
+    }
+    close(fd);
+    return result;
+}
+
+/*
+* Function: cache_send:
+* ---------------------
+* Sends a part of a file to a descriptor with sendfile, without copying it to
+* the minishell. If sendfile can not be used with out the file is copied.
+*
+*  out: descriptor where the data is sent.
+*  fd: descriptor of the file.
+*  offset: first byte to send.
+*  length: number of bytes to send.
+*  sent: pointer where the number of bytes sent is added or NULL.
+*
+*  returns: exit success or exit failure if there is an error.
+*/
+int cache_send(int out, int fd, off_t offset, uint64_t length,
+               uint64_t *sent)
+{
+    while (length)
+    {
+        ssize_t n = sendfile(out, fd, &offset, length);
+        if (n < 0 && (errno == EINVAL || errno == ENOSYS))
+        {
+            // Copies the file with read and write.
+            char buffer[4096];
+            n = pread(fd, buffer, length < sizeof(buffer) ? length
+                                                          : sizeof(buffer),
+                      offset);
+            ssize_t written = n > 0 ? write(out, buffer, n) : 0;
+            if (written != (n > 0 ? n : 0))
+            {
+                if (written > 0 && sent)
+                {
+                    *sent += written;
+                }
+                return EXIT_FAILURE;
+            }
+            offset += n > 0 ? n : 0;
+        }
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return EXIT_FAILURE;
+        }
+        length -= n;
+        if (sent)
+        {
+            *sent += n;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: cache_store:
+* ----------------------
+* Stores an entry. It is written in a temporary file that is renamed, so
+* other minishells never read a half written entry.
+*
+*  path: path of the entry.
+*  key: key of the command.
+*  output: output of the command.
+*  status: exit status of the command.
+*
+*  returns: exit success or exit failure if there is an error.
+*/
+int cache_store(char *path, struct capture *key, struct capture *output,
+                int status)
+{
+    char temporary[COMMAND_LINE_SIZE + 8];
+    snprintf(temporary, sizeof(temporary), "%s.XXXXXX", path);
+    int fd = mkostemp(temporary, O_CLOEXEC);
+    if (fd < 0)
+    {
+        perror("mkostemp");
+        return EXIT_FAILURE;
+    }
+    // Writes the header, the key and the output.
+    struct cache_header header;
+    struct timespec now;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CACHE_MAGIC, sizeof(header.magic));
+    clock_gettime(CLOCK_REALTIME, &now);
+    header.status = status;
+    header.created = now.tv_sec * 1000000000LL + now.tv_nsec;
+    header.key_length = key->length;
+    header.output_length = output->length;
+    struct iovec parts[3] = {{&header, sizeof(header)},
+                             {key->data, key->length},
+                             {output->data, output->length}};
+    ssize_t total = sizeof(header) + key->length + output->length;
+    int result = writev(fd, parts, 3) == total ? EXIT_SUCCESS : EXIT_FAILURE;
+    close(fd);
+    if (result || rename(temporary, path))
+    {
+        unlink(temporary);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
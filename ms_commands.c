@@ -0,0 +1,423 @@
+/*
+* Table of commands of libminishell: hash table with the internal commands,
+* the functions and the aliases, so the name of a command is found with a
+* single lookup before searching it in the PATH. Also the internal commands
+* alias and unalias.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#include "ms_internal.h"
+
+/*
+* Structure for an internal command of the table:
+* -----------------------------------------------
+*  name: name of the internal command.
+*  function: function that executes it.
+*/
+struct builtin_info
+{
+    const char *name;
+    int (*function)(char **args);
+};
+
+// Internal commands.
+static const struct builtin_info builtins[] = {
+    {"cd", internal_cd},
+    {"export", internal_export},
+    {"source", internal_source},
+    {"jobs", internal_jobs},
+    {"exit", internal_exit},
+    {"exec", internal_exec},
+    {"fg", internal_fg},
+    {"bg", internal_bg},
+    {"trace", internal_trace},
+    {"timeout", internal_timeout},
+    {"ulimit", internal_ulimit},
+    {"pin", internal_pin},
+    {"submit", internal_submit},
+    {"wait", internal_wait},
+    {"kill", internal_kill},
+    {"alias", internal_alias},
+    {"unalias", internal_unalias},
+    {"cache", internal_cache},
+    {"parallel", internal_parallel},
+    {"mapchunks", internal_mapchunks},
+    {"pool", internal_pool},
+    {"record", internal_record},
+    {"replay", internal_replay},
+    {NULL, NULL}};
+
+/*
+* Function: commands_init:
+* ------------------------
+* Adds the internal commands to the table of commands.
+*
+*  returns: exit success or exit failure if there is no memory.
+*/
+int commands_init()
+{
+    for (int i = 0; builtins[i].name; i++)
+    {
+        struct command_entry *entry = command_add(builtins[i].name);
+        if (!entry)
+        {
+            return EXIT_FAILURE;
+        }
+        entry->builtin = builtins[i].function;
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: commands_free:
+* ------------------------
+* Frees all the commands of a table.
+*
+*  commands: hash table of a context.
+*
+*  returns: void.
+*/
+void commands_free(struct command_entry **commands)
+{
+    for (int i = 0; i < COMMANDS_SIZE; i++)
+    {
+        while (commands[i])
+        {
+            struct command_entry *next = commands[i]->next;
+            script_free(commands[i]->function);
+            free(commands[i]->alias);
+            free(commands[i]->name);
+            free(commands[i]);
+            commands[i] = next;
+        }
+    }
+}
+
+/*
+* Function: command_hash:
+* -----------------------
+* Calculates the position of a name in the table of commands (FNV-1a).
+*
+*  name: name of the command.
+*
+*  returns: position in the table.
+*/
+unsigned int command_hash(const char *name)
+{
+    unsigned int hash = 2166136261u;
+    for (const char *ptr = name; *ptr; ptr++)
+    {
+        hash = (hash ^ (unsigned char)*ptr) * 16777619u;
+    }
+    return hash % COMMANDS_SIZE;
+}
+
+/*
+* Function: command_find:
+* -----------------------
+* Looks for a name in the table of commands.
+*
+*  name: name of the command.
+*
+*  returns: the command or NULL if it is not in the table.
+*/
+struct command_entry *command_find(const char *name)
+{
+    struct command_entry *entry = ms->commands[command_hash(name)];
+    while (entry && strcmp(entry->name, name))
+    {
+        entry = entry->next;
+    }
+    return entry;
+}
+
+/*
+* Function: command_add:
+* ----------------------
+* Looks for a name in the table of commands and adds it if it is not there.
+*
+*  name: name of the command.
+*
+*  returns: the command or NULL if there is no memory.
+*/
+struct command_entry *command_add(const char *name)
+{
+    struct command_entry *entry = command_find(name);
+    if (entry)
+    {
+        return entry;
+    }
+    entry = calloc(1, sizeof(struct command_entry));
+    if (!entry || !(entry->name = strdup(name)))
+    {
+        perror("malloc");
+        free(entry);
+        return NULL;
+    }
+    unsigned int position = command_hash(name);
+    entry->next = ms->commands[position];
+    ms->commands[position] = entry;
+    return entry;
+}
+
+/*
+* Function: alias_expand:
+* -----------------------
+* Replaces the first token with the text of its alias. The text of the alias
+* is not expanded again, so an alias can use the command with its name.
+*
+*  tokens: pointer array that storages all the tokens in a command line.
+*  aliased: array of ARGS_SIZE pointers where the new tokens are stored.
+*  text: pointer where the copy of the alias is stored, it has to be freed.
+*
+*  returns: aliased if the first token is an alias, otherwise tokens.
+*/
+char **alias_expand(char **tokens, char **aliased, char **text)
+{
+    struct command_entry *entry = command_find(tokens[0]);
+    if (!entry || !entry->alias || !(*text = strdup(entry->alias)))
+    {
+        return tokens;
+    }
+    // The tokens of the alias are followed by the arguments.
+    int n = parse_args(aliased, *text);
+    for (int i = 1; tokens[i] && n < ARGS_SIZE - 1; i++)
+    {
+        aliased[n++] = tokens[i];
+    }
+    aliased[n] = NULL;
+    return aliased;
+}
+
+/*
+* Function: function_define:
+* --------------------------
+* Saves a copy of the body of a function, replacing the previous function
+* with the same name. The previous body is freed when its calls finish.
+*
+*  name: name of the function.
+*  body: compiled body of the function.
+*
+*  returns: exit success or exit failure if there is no memory.
+*/
+int function_define(char *name, struct script_node *body)
+{
+    struct command_entry *entry = command_add(name);
+    struct script_node *copy = entry ? script_copy(body) : NULL;
+    if (!copy)
+    {
+        return EXIT_FAILURE;
+    }
+    if (entry->function && !entry->function->references)
+    {
+        script_free(entry->function);
+    }
+    entry->function = copy;
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: function_call:
+* ------------------------
+* Executes a function in the minishell, without creating a son (in a $(...)
+* it is called by the son of the substitution). The arguments are the 
+* positional parameters ($1, $2...) during the call.
+*
+*  entry: command of the function.
+*  args: pointer array with the name of the function and its arguments.
+*
+*  returns: the exit status of the function.
+*/
+int function_call(struct command_entry *entry, char **args)
+{
+    if (ms->function_depth == FUNCTION_DEPTH)
+    {
+        fprintf(stderr, "%s: demasiadas llamadas anidadas (máximo %d)\n",
+                args[0], FUNCTION_DEPTH);
+        return EXIT_FAILURE;
+    }
+    // Saves the parameters and the loops of the caller.
+    char **positional = ms->positional;
+    int n_positional = ms->n_positional;
+    int loop_depth = ms->loop_depth;
+    ms->positional = args;
+    for (ms->n_positional = 0; args[ms->n_positional]; ms->n_positional++)
+    {
+    }
+    ms->loop_depth = 0;
+    ms->function_depth++;
+
+    // Executes the body, that can not be freed while it is executed.
+    struct script_node *body = entry->function;
+    body->references++;
+    int status = script_execute(body);
+    body->references--;
+    if (!body->references && entry->function != body)
+    {
+        script_free(body);
+    }
+    // Restores the caller.
+    ms->function_depth--;
+    ms->returning = 0;
+    ms->loop_depth = loop_depth;
+    ms->positional = positional;
+    ms->n_positional = n_positional;
+    return status;
+}
+
+/*
+* Function: internal_alias:
+* -------------------------
+* Defines an alias with alias name=text, the text can be between quotes.
+* Without arguments it shows all the aliases and with a name it shows its
+* alias.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: exit success or exit failure if the alias does not exist.
+*/
+int internal_alias(char **args)
+{
+    // Shows all the aliases sorted by name.
+    if (!args[1])
+    {
+        int n = 0;
+        for (int i = 0; i < COMMANDS_SIZE; i++)
+        {
+            for (struct command_entry *entry = ms->commands[i]; entry;
+                 entry = entry->next)
+            {
+                n++;
+            }
+        }
+        struct command_entry **aliases = malloc(sizeof(*aliases) * n);
+        if (!aliases)
+        {
+            perror("malloc");
+            return EXIT_FAILURE;
+        }
+        n = 0;
+        for (int i = 0; i < COMMANDS_SIZE; i++)
+        {
+            for (struct command_entry *entry = ms->commands[i]; entry;
+                 entry = entry->next)
+            {
+                if (entry->alias)
+                {
+                    aliases[n++] = entry;
+                }
+            }
+        }
+        qsort(aliases, n, sizeof(struct command_entry *), alias_compare);
+        for (int i = 0; i < n; i++)
+        {
+            printf("alias %s='%s'\n", aliases[i]->name, aliases[i]->alias);
+        }
+        free(aliases);
+        return EXIT_SUCCESS;
+    }
+    // The text of the alias can have blanks.
+    char line[COMMAND_LINE_SIZE];
+    join_args(args + 1, line);
+    char *text = strchr(line, '=');
+    if (!text)
+    {
+        struct command_entry *entry = command_find(args[1]);
+        if (!entry || !entry->alias)
+        {
+            fprintf(stderr, "alias: %s: no existe\n", args[1]);
+            return EXIT_FAILURE;
+        }
+        printf("alias %s='%s'\n", entry->name, entry->alias);
+        return EXIT_SUCCESS;
+    }
+    *text = '\0';
+    text++;
+    if (!*line || strchr(line, '/'))
+    {
+        fprintf(stderr, "Error de sintaxis. Uso: alias nombre=texto\n");
+        return EXIT_FAILURE;
+    }
+    // Removes the quotes.
+    size_t length = strlen(text);
+    if (length >= 2 && (*text == '\'' || *text == '"') &&
+        text[length - 1] == *text)
+    {
+        text[length - 1] = '\0';
+        text++;
+    }
+    struct command_entry *entry = command_add(line);
+    char *alias = entry ? strdup(text) : NULL;
+    if (!alias)
+    {
+        return EXIT_FAILURE;
+    }
+    free(entry->alias);
+    entry->alias = alias;
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: internal_unalias:
+* ---------------------------
+* Removes the aliases of the arguments or all of them with unalias -a.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: exit success or exit failure if an alias does not exist.
+*/
+int internal_unalias(char **args)
+{
+    if (!args[1])
+    {
+        fprintf(stderr, "Error de sintaxis. Uso: unalias [-a] nombre...\n");
+        return EXIT_FAILURE;
+    }
+    int result = EXIT_SUCCESS;
+    if (!strcmp(args[1], "-a"))
+    {
+        for (int i = 0; i < COMMANDS_SIZE; i++)
+        {
+            for (struct command_entry *entry = ms->commands[i]; entry;
+                 entry = entry->next)
+            {
+                free(entry->alias);
+                entry->alias = NULL;
+            }
+        }
+        return result;
+    }
+    for (int i = 1; args[i]; i++)
+    {
+        struct command_entry *entry = command_find(args[i]);
+        if (!entry || !entry->alias)
+        {
+            fprintf(stderr, "unalias: %s: no existe\n", args[i]);
+            result = EXIT_FAILURE;
+            continue;
+        }
+        free(entry->alias);
+        entry->alias = NULL;
+    }
+    return result;
+}
+
+/*
+* Function: alias_compare:
+* ------------------------
+* Compares two commands by their name, used by qsort.
+*
+*  a, b: pointers to the commands.
+*
+*  returns: the result of strcmp of the names.
+*/
+int alias_compare(const void *a, const void *b)
+{
+    return strcmp((*(struct command_entry **)a)->name,
+                  (*(struct command_entry **)b)->name);
+}
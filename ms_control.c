@@ -0,0 +1,279 @@
+/*
+* Control socket of libminishell: a Unix domain socket where clients can 
+* execute command lines and receive the events of the finished jobs.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#include "ms_internal.h"
+
+/*
+* Function: control_listen:
+* -------------------------
+* Creates the control socket, a Unix domain socket where clients can send 
+* command lines to the minishell. Each line is executed and its output is 
+* sent to the client followed by a null character. The line "watch" makes the
+* client receive a line "done PID STATUS COMMAND" when a background job 
+* finishes and "exit" closes the connection. All the clients are attended in 
+* the event loop.
+*
+*  path: path of the socket, it is removed if it exists.
+*
+*  returns: exit success or exit failure if the socket could not be created.
+*/
+int control_listen(char *path)
+{
+    struct sockaddr_un address;
+    struct epoll_event event;
+
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        fprintf(stderr, "La ruta del socket es demasiado larga.\n");
+        return EXIT_FAILURE;
+    }
+    // The clients can close the connection while they receive data.
+    signal(SIGPIPE, SIG_IGN);
+    // Creates the socket.
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+    unlink(path);
+    ms->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (ms->listen_fd < 0 ||
+        bind(ms->listen_fd, (struct sockaddr *)&address, sizeof(address)) ||
+        listen(ms->listen_fd, N_CLIENTS))
+    {
+        perror("control_listen");
+        return EXIT_FAILURE;
+    }
+    ms->listen_fd = event_high_fd(ms->listen_fd);
+    // Registers the socket in the event loop.
+    event.events = EPOLLIN;
+    event.data.fd = ms->listen_fd;
+    epoll_ctl(ms->event_fd, EPOLL_CTL_ADD, ms->listen_fd, &event);
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: control_accept:
+* -------------------------
+* Accepts a new client of the control socket and adds it to the event loop.
+*
+*  returns: exit success or exit failure if the client was not accepted.
+*/
+int control_accept()
+{
+    struct epoll_event event;
+    int fd = accept4(ms->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0)
+    {
+        perror("accept");
+        return EXIT_FAILURE;
+    }
+    fd = event_high_fd(fd);
+    // Searches a free position for the client.
+    for (int i = 0; i < N_CLIENTS; i++)
+    {
+        if (ms->clients[i].fd < 0)
+        {
+            ms->clients[i].fd = fd;
+            ms->clients[i].watching = 0;
+            ms->clients[i].used = 0;
+            event.events = EPOLLIN;
+            event.data.fd = fd;
+            epoll_ctl(ms->event_fd, EPOLL_CTL_ADD, fd, &event);
+            trace_event('i', "control", "accept", fd);
+            return EXIT_SUCCESS;
+        }
+    }
+    fprintf(stderr, "No se pueden aceptar más clientes.\n");
+    close(fd);
+    return EXIT_FAILURE;
+}
+
+/*
+* Function: control_find:
+* -----------------------
+* Searches the client that uses a descriptor.
+*
+*  fd: descriptor.
+*
+*  returns: position of the client in clients or -1 if the descriptor is not
+*           a client.
+*/
+int control_find(int fd)
+{
+    for (int i = 0; fd >= 0 && i < N_CLIENTS; i++)
+    {
+        if (ms->clients[i].fd == fd)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+* Function: control_read:
+* -----------------------
+* Reads the data sent by a client and executes each complete line. While a 
+* line is being executed the clients are not read, they are removed from the
+* event loop and their data waits in the socket until the line has finished.
+*
+*  fd: descriptor of the client.
+*
+*  returns: exit success or exit failure if the client has been closed.
+*/
+int control_read(int fd)
+{
+    static int executing = 0;
+    struct epoll_event event;
+    event.data.fd = fd;
+
+    // Searches the client.
+    int client = control_find(fd);
+    if (client < 0)
+    {
+        return EXIT_SUCCESS;
+    }
+    // Stops watching the client until the current line has finished.
+    if (executing)
+    {
+        event.events = 0;
+        epoll_ctl(ms->event_fd, EPOLL_CTL_MOD, fd, &event);
+        return EXIT_SUCCESS;
+    }
+    struct control_client *c = &ms->clients[client];
+    ssize_t n = read(fd, c->buffer + c->used, COMMAND_LINE_SIZE - 1 - c->used);
+    if (n <= 0)
+    {
+        // The client has closed the connection.
+        epoll_ctl(ms->event_fd, EPOLL_CTL_DEL, fd, NULL);
+        close(fd);
+        ms->n_watching -= c->watching;
+        c->fd = -1;
+        return EXIT_FAILURE;
+    }
+    c->used += n;
+    c->buffer[c->used] = '\0';
+
+    // Executes all the complete lines.
+    executing = 1;
+    char *start = c->buffer;
+    char *end;
+    while (c->fd >= 0 && (end = strchr(start, '\n')))
+    {
+        *end = '\0';
+        control_execute(client, start);
+        start = end + 1;
+    }
+    executing = 0;
+
+    // Watches again the clients that were stopped.
+    for (int i = 0; i < N_CLIENTS; i++)
+    {
+        if (ms->clients[i].fd >= 0)
+        {
+            event.events = EPOLLIN;
+            event.data.fd = ms->clients[i].fd;
+            epoll_ctl(ms->event_fd, EPOLL_CTL_MOD, ms->clients[i].fd, &event);
+        }
+    }
+    if (c->fd < 0)
+    {
+        return EXIT_FAILURE;
+    }
+    // Keeps the incomplete line, a line too long is discarded.
+    c->used = strlen(start);
+    memmove(c->buffer, start, c->used + 1);
+    if (c->used == COMMAND_LINE_SIZE - 1)
+    {
+        dprintf(fd, "Línea demasiado larga.\n%c", '\0');
+        c->used = 0;
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: control_execute:
+* --------------------------
+* Executes a line sent by a client with the standard output and error of 
+* the minishell redirected to the client.
+*
+*  client: position of the client.
+*  line: line to execute.
+*
+*  returns: exit success or exit failure if the client has been closed.
+*/
+int control_execute(int client, char *line)
+{
+    struct control_client *c = &ms->clients[client];
+    trace_event('i', "control", line, c->fd);
+
+    // Lines that control the connection.
+    if (!strcmp(line, "exit"))
+    {
+        epoll_ctl(ms->event_fd, EPOLL_CTL_DEL, c->fd, NULL);
+        close(c->fd);
+        ms->n_watching -= c->watching;
+        c->fd = -1;
+        return EXIT_FAILURE;
+    }
+    if (!strcmp(line, "watch"))
+    {
+        ms->n_watching += !c->watching;
+        c->watching = 1;
+    }
+    else
+    {
+        // Redirects stdout and stderr to the client while the line executes.
+        fflush(stdout);
+        fflush(stderr);
+        int saved_out = fcntl(1, F_DUPFD_CLOEXEC, USER_FDS);
+        int saved_err = fcntl(2, F_DUPFD_CLOEXEC, USER_FDS);
+        dup2(c->fd, 1);
+        dup2(c->fd, 2);
+        execute_line(line);
+        fflush(stdout);
+        fflush(stderr);
+        dup2(saved_out, 1);
+        dup2(saved_err, 2);
+        close(saved_out);
+        close(saved_err);
+    }
+    // Marks the end of the answer.
+    send(c->fd, "", 1, MSG_NOSIGNAL);
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: control_broadcast:
+* ----------------------------
+* Sends the event of a finished job to the clients that are watching, with
+* the status like $? (128 + signal if a signal ended the job).
+*
+*  event: finished job.
+*
+*  returns: the number of clients that received the event.
+*/
+int control_broadcast(struct job_event *event)
+{
+    char text[COMMAND_LINE_SIZE];
+    int sent = 0;
+    int length = snprintf(text, sizeof(text), "done %d %d %s\n",
+                          event->pid, exit_status(event->status),
+                          event->command_line);
+    for (int i = 0; i < N_CLIENTS; i++)
+    {
+        if (ms->clients[i].fd >= 0 && ms->clients[i].watching)
+        {
+            send(ms->clients[i].fd, text, length, MSG_NOSIGNAL);
+            sent++;
+        }
+    }
+    return sent;
+}
@@ -0,0 +1,406 @@
+/*
+* Event loop of libminishell: the epoll instance where the minishell waits 
+* for its jobs, the input and the timeouts of the timerfd.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#include "ms_internal.h"
+
+/*
+* Function: monotonic_ns:
+* -----------------------
+* Reads the monotonic clock.
+*
+*  returns: the monotonic time in nanoseconds.
+*/
+long long monotonic_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+/*
+* Function: event_init:
+* ---------------------
+* Creates the event loop of the minishell: an epoll instance that waits for 
+* the wake pipe (written by the signal handlers) and the input. The timerfd 
+* of the timeouts is created with the first timeout.
+*
+*  returns: exit success or exit failure if it could not be created.
+*/
+int event_init()
+{
+    struct epoll_event event;
+
+    // Creates the epoll instance and the wake pipe.
+    ms->event_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (ms->event_fd < 0 || pipe2(ms->wake_pipe, O_NONBLOCK | O_CLOEXEC))
+    {
+        perror("event_init");
+        return EXIT_FAILURE;
+    }
+    // Leaves the descriptors 3 to 9 free for exec N>fichero.
+    ms->event_fd = event_high_fd(ms->event_fd);
+    ms->wake_pipe[0] = event_high_fd(ms->wake_pipe[0]);
+    ms->wake_pipe[1] = event_high_fd(ms->wake_pipe[1]);
+
+    // Registers the wake pipe.
+    event.events = EPOLLIN;
+    event.data.fd = ms->wake_pipe[0];
+    epoll_ctl(ms->event_fd, EPOLL_CTL_ADD, ms->wake_pipe[0], &event);
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: event_high_fd:
+* ------------------------
+* Moves a descriptor of the minishell to a number not lower than USER_FDS, 
+* so the user can redirect the descriptors below it with exec without 
+* closing the descriptors of the minishell.
+*
+*  fd: descriptor to move, it is closed if it is moved.
+*
+*  returns: the new descriptor (close on exec) or fd if it was not moved.
+*/
+int event_high_fd(int fd)
+{
+    if (fd < 0 || fd >= USER_FDS)
+    {
+        return fd;
+    }
+    int high = fcntl(fd, F_DUPFD_CLOEXEC, USER_FDS);
+    if (high < 0)
+    {
+        return fd;
+    }
+    close(fd);
+    return high;
+}
+
+/*
+* Function: event_wake:
+* ---------------------
+* Wakes up the event loop. It can be called from a signal handler.
+*
+*  returns: void.
+*/
+void event_wake()
+{
+    int saved_errno = errno;
+    if (write(ms->wake_pipe[1], "w", 1) < 0)
+    {
+        // The pipe is full, so the loop is already going to wake up.
+    }
+    errno = saved_errno;
+}
+
+/*
+* Function: event_wait:
+* ---------------------
+* Waits until something happens in the event loop and attends the expired 
+* timeouts. The signals also interrupt the wait.
+*
+*  fd: descriptor to wait for input or -1 to wait only for the jobs.
+*
+*  returns: 1 if fd can be read, otherwise 0.
+*/
+int event_wait(int fd)
+{
+    struct epoll_event events[EVENTS_SIZE];
+    struct epoll_event event;
+    char buffer[64];
+    uint64_t expirations;
+    int ready = 0;
+
+    // Changes the watched descriptor if it is not the same as before.
+    if (fd != ms->watched_fd)
+    {
+        if (ms->watched_fd >= 0)
+        {
+            epoll_ctl(ms->event_fd, EPOLL_CTL_DEL, ms->watched_fd, NULL);
+        }
+        ms->watched_fd = fd;
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (fd >= 0 && epoll_ctl(ms->event_fd, EPOLL_CTL_ADD, fd, &event))
+        {
+            // Regular files can not be watched, they can always be read.
+            ms->watched_fd = -1;
+            return 1;
+        }
+    }
+    // Forks the sons that the pool is missing before waiting.
+    pool_fill();
+    int n = epoll_wait(ms->event_fd, events, EVENTS_SIZE, -1);
+    for (int i = 0; i < n; i++)
+    {
+        if (events[i].data.fd == ms->wake_pipe[0])
+        {
+            // Empties the wake pipe.
+            while (read(ms->wake_pipe[0], buffer, sizeof(buffer)) > 0)
+            {
+            }
+        }
+        else if (events[i].data.fd == ms->timer_fd)
+        {
+            // Sends the signals of the expired timeouts.
+            if (read(ms->timer_fd, &expirations, sizeof(expirations)) > 0)
+            {
+                timers_expire();
+            }
+        }
+        else if (events[i].data.fd == fd)
+        {
+            ready = 1;
+        }
+        else if (events[i].data.fd == ms->listen_fd)
+        {
+            control_accept();
+        }
+        else if (control_find(events[i].data.fd) >= 0)
+        {
+            control_read(events[i].data.fd);
+        }
+    }
+    // Prints what the signal handlers have left, updates the jobs list with
+    // the reaped jobs and launches the queued jobs if some slot has been 
+    // freed.
+    interrupt_drain();
+    reap_drain();
+    queue_pump();
+    return ready;
+}
+
+/*
+* Function: timer_add:
+* --------------------
+* Adds a timeout to the heap and programs the timerfd if it is the first one 
+* to expire.
+*
+*  pid: job that receives the signal.
+*  deadline: monotonic time in nanoseconds when the signal is sent.
+*  signal: signal to send.
+*  kill_after: nanoseconds until SIGKILL is sent after signal, 0 if not.
+*
+*  returns: exit success or exit failure if there is no memory.
+*/
+int timer_add(pid_t pid, long long deadline, int signal, long long kill_after)
+{
+    // Creates the timerfd with the first timeout.
+    if (ms->timer_fd < 0)
+    {
+        struct epoll_event event;
+        ms->timer_fd = timerfd_create(CLOCK_MONOTONIC,
+                                      TFD_NONBLOCK | TFD_CLOEXEC);
+        if (ms->timer_fd < 0)
+        {
+            perror("timerfd_create");
+            return EXIT_FAILURE;
+        }
+        ms->timer_fd = event_high_fd(ms->timer_fd);
+        event.events = EPOLLIN;
+        event.data.fd = ms->timer_fd;
+        epoll_ctl(ms->event_fd, EPOLL_CTL_ADD, ms->timer_fd, &event);
+    }
+    // Doubles the size of the heap if it is full.
+    if (ms->n_timers == ms->timers_size)
+    {
+        int size = ms->timers_size ? ms->timers_size * 2 : 16;
+        struct timer_entry *aux = realloc(ms->timers, 
+                                          sizeof(struct timer_entry) * size);
+        if (!aux)
+        {
+            perror("realloc");
+            return EXIT_FAILURE;
+        }
+        ms->timers = aux;
+        ms->timers_size = size;
+    }
+    // Inserts the timeout at the end and moves it up.
+    int pos = ms->n_timers++;
+    while (pos > 0 && ms->timers[(pos - 1) / 2].deadline > deadline)
+    {
+        ms->timers[pos] = ms->timers[(pos - 1) / 2];
+        pos = (pos - 1) / 2;
+    }
+    ms->timers[pos].deadline = deadline;
+    ms->timers[pos].pid = pid;
+    ms->timers[pos].signal = signal;
+    ms->timers[pos].kill_after = kill_after;
+
+    // Reprograms the timerfd if the new timeout is the first one.
+    if (pos == 0)
+    {
+        return timers_arm();
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: timers_arm:
+* ---------------------
+* Programs the timerfd with the first deadline of the heap, or disarms it if 
+* there are no timeouts.
+*
+*  returns: exit success or exit failure if the timerfd failed.
+*/
+int timers_arm()
+{
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (ms->n_timers)
+    {
+        // A zero value disarms the timer, so at least 1ns is used.
+        long long deadline = ms->timers[0].deadline;
+        deadline = deadline > 0 ? deadline : 1;
+        spec.it_value.tv_sec = deadline / 1000000000LL;
+        spec.it_value.tv_nsec = deadline % 1000000000LL;
+    }
+    if (timerfd_settime(ms->timer_fd, TFD_TIMER_ABSTIME, &spec, NULL))
+    {
+        perror("timerfd_settime");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: timers_remove:
+* ------------------------
+* Removes a timeout from the heap: the last timeout takes its position and
+* is moved down or up.
+*
+*  pos: position of the timeout in the heap.
+*
+*  returns: void.
+*/
+void timers_remove(int pos)
+{
+    struct timer_entry last = ms->timers[--ms->n_timers];
+    if (pos == ms->n_timers)
+    {
+        return;
+    }
+    pos = timers_down(pos, last);
+    while (pos > 0 && ms->timers[(pos - 1) / 2].deadline > last.deadline)
+    {
+        ms->timers[pos] = ms->timers[(pos - 1) / 2];
+        pos = (pos - 1) / 2;
+    }
+    ms->timers[pos] = last;
+}
+
+/*
+* Function: timers_down:
+* ----------------------
+* Moves a timeout down the heap from a position until its sons expire 
+* later. The timeout is not stored, the caller stores it.
+*
+*  pos: position where the timeout starts.
+*  entry: timeout to move.
+*
+*  returns: the final position of the timeout.
+*/
+int timers_down(int pos, struct timer_entry entry)
+{
+    while (2 * pos + 1 < ms->n_timers)
+    {
+        int child = 2 * pos + 1;
+        if (child + 1 < ms->n_timers &&
+            ms->timers[child + 1].deadline < ms->timers[child].deadline)
+        {
+            child++;
+        }
+        if (entry.deadline <= ms->timers[child].deadline)
+        {
+            break;
+        }
+        ms->timers[pos] = ms->timers[child];
+        pos = child;
+    }
+    return pos;
+}
+
+/*
+* Function: timer_cancel:
+* -----------------------
+* Removes the timeouts of a job that has finished, so they do not keep the
+* minishell waiting and they do not signal another process with its pid. 
+* The other timeouts are compacted in one pass and the heap is rebuilt once.
+*
+*  pid: job that has finished.
+*
+*  returns: void.
+*/
+void timer_cancel(pid_t pid)
+{
+    int kept = 0;
+    for (int i = 0; i < ms->n_timers; i++)
+    {
+        if (ms->timers[i].pid != pid)
+        {
+            ms->timers[kept++] = ms->timers[i];
+        }
+    }
+    if (kept == ms->n_timers)
+    {
+        return;
+    }
+    // Rebuilds the heap from the last timeout with sons.
+    ms->n_timers = kept;
+    for (int i = kept / 2 - 1; i >= 0; i--)
+    {
+        struct timer_entry entry = ms->timers[i];
+        ms->timers[timers_down(i, entry)] = entry;
+    }
+    if (ms->timer_fd >= 0)
+    {
+        timers_arm();
+    }
+}
+
+/*
+* Function: timers_expire:
+* ------------------------
+* Removes from the heap all the expired timeouts and sends their signals to 
+* the jobs that are still active. If a timeout has a kill_after, a new one is 
+* added to send SIGKILL.
+*
+*  returns: the number of signals sent.
+*/
+int timers_expire()
+{
+    long long now = monotonic_ns();
+    int sent = 0;
+
+    // The timeouts of the jobs reaped since the last drain are removed, so
+    // their pids are not signalled if they have been reused.
+    reap_drain();
+    while (ms->n_timers && ms->timers[0].deadline <= now)
+    {
+        struct timer_entry expired = ms->timers[0];
+        timers_remove(0);
+
+        // Only the jobs that have not finished receive the signal.
+        if (jobs_list_find(expired.pid) >= 0)
+        {
+            trace_event('i', "timeout", "", expired.pid);
+            ms->timed_out = expired.pid;
+            kill(expired.pid, expired.signal);
+            kill(expired.pid, SIGCONT);
+            sent++;
+            if (expired.kill_after)
+            {
+                timer_add(expired.pid, now + expired.kill_after, SIGKILL, 0);
+            }
+        }
+    }
+    timers_arm();
+    return sent;
+}
@@ -0,0 +1,1339 @@
+/*
+* Executor of libminishell: public interface of the library, execution of 
+* the command lines, creation of the sons and the signal handlers.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#include "ms_internal.h"
+
+// The only context, it receives the signals and is used by the internal
+// functions.
+struct ms_context *ms = NULL;
+
+/*
+* Function: ms_create:
+* --------------------
+* Creates the context of a minishell, its event loop, and sets the signal 
+* handlers of the process for this context. Only one context can exist at a
+* time, the signal handlers and the internal functions use it.
+*
+*  name: name of the minishell (argv[0]).
+*
+*  returns: the new context or NULL if it could not be created or another
+*           context exists (errno is EBUSY).
+*/
+struct ms_context *ms_create(const char *name)
+{
+    if (ms)
+    {
+        errno = EBUSY;
+        return NULL;
+    }
+    // Allocates memory for the context, all the fields start at zero.
+    struct ms_context *ctx = calloc(1, sizeof(struct ms_context));
+    if (!ctx)
+    {
+        return NULL;
+    }
+    ms = ctx;
+    ms->event_fd = ms->timer_fd = ms->watched_fd = ms->listen_fd = -1;
+    ms->wake_pipe[0] = ms->wake_pipe[1] = ms->record_fd = -1;
+    ms->pin_policy = PIN_OFF;
+    ms->queue_policy = QUEUE_FIFO;
+    for (int i = 0; i < N_CLIENTS; i++)
+    {
+        ms->clients[i].fd = -1;
+    }
+
+    // Allocates the jobs list, the position 0 is the foreground, and the 
+    // table of commands.
+    ms->jobs_list = calloc(N_JOBS, sizeof(struct info_process));
+    ms->free_jobs = malloc(sizeof(int) * N_JOBS);
+    if (!ms->jobs_list || !ms->free_jobs || commands_init())
+    {
+        ms_destroy(ctx);
+        return NULL;
+    }
+    ms->jobs_size = N_JOBS;
+    ms->jobs_used = 1;
+    ms->next_job_id = 1;
+
+    // Sets the necessary values to recognize the minishell.
+    ms->minishell.pid = getpid();
+    ms->minishell.status = EXECUTED;
+    snprintf(ms->minishell.command_line, COMMAND_LINE_SIZE, "%s", name);
+
+    // Sets the foreground default values (no active job).
+    ms->foreground.pid = FOREGROUND;
+    ms->foreground.status = EXECUTED;
+    ms->foreground.command_line[0] = '\0';
+
+    // Creates the event loop used to wait for jobs, timeouts and input.
+    if (event_init())
+    {
+        ms_destroy(ctx);
+        return NULL;
+    }
+
+    // Sets action (reaper) for signal SIGCHILD.
+    signal(SIGCHLD, reaper);
+
+    // Sets action (ctrlc) for signal SIGINT.
+    signal(SIGINT, ctrlc);
+
+    // Sets action (ctrlz) for signal SIGTSTP.
+    signal(SIGTSTP, ctrlz);
+
+    //Initialize the foreground when there is no active job.
+    ms->jobs_list[FOREGROUND].pid = ms->foreground.pid;
+    ms->jobs_list[FOREGROUND].status = ms->foreground.status;
+    strcpy(ms->jobs_list[FOREGROUND].command_line,
+           ms->foreground.command_line);
+    return ctx;
+}
+
+/*
+* Function: ms_destroy:
+* ---------------------
+* Frees the context and restores the default actions of the signals, so a
+* new context can be created. The jobs that are still running are not 
+* stopped.
+*
+*  ctx: context to free.
+*
+*  returns: void.
+*/
+void ms_destroy(struct ms_context *ctx)
+{
+    int fds[] = {ctx->event_fd, ctx->wake_pipe[0], ctx->wake_pipe[1],
+                 ctx->timer_fd, ctx->listen_fd, ctx->record_fd};
+
+    // Restores the signals.
+    if (ms == ctx)
+    {
+        signal(SIGCHLD, SIG_DFL);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTSTP, SIG_DFL);
+        ms = NULL;
+    }
+    // Closes the descriptors of the event loop, the control socket and the
+    // pool, whose sons end.
+    for (int i = 0; i < (int)(sizeof(fds) / sizeof(fds[0])); i++)
+    {
+        if (fds[i] >= 0)
+        {
+            close(fds[i]);
+        }
+    }
+    for (int i = 0; i < ctx->n_pool; i++)
+    {
+        close(ctx->pool[i].fd);
+    }
+    for (int i = 0; ctx->listen_fd >= 0 && i < N_CLIENTS; i++)
+    {
+        if (ctx->clients[i].fd >= 0)
+        {
+            close(ctx->clients[i].fd);
+        }
+    }
+    // Frees the queue, the timeouts and the trace.
+    for (int i = 0; i < ctx->n_queue; i++)
+    {
+        free(ctx->queue[i].command_line);
+        free(ctx->queue[i].args);
+    }
+    free(ctx->queue);
+    free(ctx->timers);
+    free(ctx->jobs_list);
+    free(ctx->free_jobs);
+    commands_free(ctx->commands);
+    if (ctx->trace_ring)
+    {
+        munmap(ctx->trace_ring, sizeof(struct trace_ring));
+    }
+    free(ctx);
+}
+
+/*
+* Function: ms_exec_line:
+* -----------------------
+* Executes a command line in a context. The line is copied, so it is not 
+* modified. If the session is being recorded, the line is added to it.
+*
+*  ctx: context of the minishell.
+*  line: command line to execute.
+*
+*  returns: the exit status of the line or exit failure if there is no memory.
+*/
+int ms_exec_line(struct ms_context *ctx, const char *line)
+{
+    char *copy = malloc(sizeof(char) * COMMAND_LINE_SIZE);
+    if (!copy)
+    {
+        return EXIT_FAILURE;
+    }
+    snprintf(copy, COMMAND_LINE_SIZE, "%s", line);
+    // The lines that start or stop the recording are not recorded.
+    int recording = ms->record_fd >= 0;
+    long long start = monotonic_ns();
+    execute_line(copy);
+    if (recording && ms->record_fd >= 0)
+    {
+        record_line(line, start, monotonic_ns() - start, ms->last_status);
+    }
+    free(copy);
+    return ms->last_status;
+}
+
+/*
+* Function: ms_source:
+* --------------------
+* Executes the lines of a script file in a context.
+*
+*  ctx: context of the minishell.
+*  path: name of the script file.
+*
+*  returns: exit success or exit failure if an error with the file happens.
+*/
+int ms_source(struct ms_context *ctx, const char *path)
+{
+    char copy[COMMAND_LINE_SIZE];
+    snprintf(copy, sizeof(copy), "%s", path);
+    return source_file(copy, 0);
+}
+
+/*
+* Function: ms_exec_script:
+* -------------------------
+* Executes a text with several lines like a script file in a context (the 
+* option -c of the minishell).
+*
+*  ctx: context of the minishell.
+*  text: commands to execute.
+*
+*  returns: the exit status of the last command or exit failure if it has a
+*           syntax error.
+*/
+int ms_exec_script(struct ms_context *ctx, const char *text)
+{
+    char *copy = strdup(text);
+    if (!copy)
+    {
+        perror("malloc");
+        return EXIT_FAILURE;
+    }
+    int result = source_text(ms->minishell.command_line, copy, 0);
+    free(copy);
+    return result;
+}
+
+/*
+* Function: ms_set_exec_last:
+* ---------------------------
+* Allows the last command of the scripts executed by ms_source and 
+* ms_exec_script to replace the process (exec) instead of creating a son, 
+* when no job, queued job or timeout needs the minishell after it.
+*
+*  ctx: context of the minishell.
+*  enabled: 1 to replace the process, 0 to always create a son.
+*
+*  returns: void.
+*/
+void ms_set_exec_last(struct ms_context *ctx, int enabled)
+{
+    ctx->exec_last = enabled;
+}
+
+/*
+* Function: ms_jobs_iter:
+* -----------------------
+* Calls a function for each job of the jobs list and for each queued job.
+*
+*  ctx: context of the minishell.
+*  callback: function called for each job, if it does not return 0 the 
+*            iteration stops.
+*  data: pointer given to callback.
+*
+*  returns: the value returned by the last call to callback or 0.
+*/
+int ms_jobs_iter(struct ms_context *ctx,
+                 int (*callback)(const struct ms_job_info *job, void *data),
+                 void *data)
+{
+    struct ms_job_info info;
+    int result = 0;
+
+    // Background and stopped jobs.
+    for (int job = 1; !result && job < ctx->jobs_used; job++)
+    {
+        if (!ctx->jobs_list[job].pid)
+        {
+            continue;
+        }
+        info.index = ctx->jobs_list[job].id;
+        info.pid = ctx->jobs_list[job].pid;
+        info.status = ctx->jobs_list[job].status;
+        info.command_line = ctx->jobs_list[job].command_line;
+        result = callback(&info, data);
+    }
+    // Queued jobs.
+    for (int i = 0; !result && i < ctx->n_queue; i++)
+    {
+        info.index = i + 1;
+        info.pid = 0;
+        info.status = QUEUED;
+        info.command_line = ctx->queue[i].command_line;
+        result = callback(&info, data);
+    }
+    return result;
+}
+
+/*
+* Function: ms_wait:
+* ------------------
+* Waits once in the event loop of a context.
+*
+*  ctx: context of the minishell.
+*  fd: descriptor to wait for input or -1 to wait only for the jobs.
+*
+*  returns: 1 if fd can be read, otherwise 0.
+*/
+int ms_wait(struct ms_context *ctx, int fd)
+{
+    return event_wait(fd);
+}
+
+/*
+* Function: ms_pump:
+* ------------------
+* Launches the queued jobs of a context that have a free slot.
+*
+*  ctx: context of the minishell.
+*
+*  returns: the number of jobs launched.
+*/
+int ms_pump(struct ms_context *ctx)
+{
+    return queue_pump();
+}
+
+/*
+* Function: ms_drain:
+* -------------------
+* Waits until all the queued jobs of a context have been launched.
+*
+*  ctx: context of the minishell.
+*
+*  returns: exit success.
+*/
+int ms_drain(struct ms_context *ctx)
+{
+    return queue_drain();
+}
+
+/*
+* Function: ms_notify:
+* --------------------
+* Prints the background jobs of a context that have finished since the last
+* call. It is called before showing the prompt.
+*
+*  ctx: context of the minishell.
+*
+*  returns: the number of finished jobs notified.
+*/
+int ms_notify(struct ms_context *ctx)
+{
+    reap_drain();
+    return jobs_notify();
+}
+
+/*
+* Function: ms_listen:
+* --------------------
+* Creates the control socket of a context. The clients are attended while 
+* the program waits in ms_wait.
+*
+*  ctx: context of the minishell.
+*  path: path of the socket.
+*
+*  returns: exit success or exit failure if the socket could not be created.
+*/
+int ms_listen(struct ms_context *ctx, const char *path)
+{
+    char copy[COMMAND_LINE_SIZE];
+    snprintf(copy, sizeof(copy), "%s", path);
+    return control_listen(copy);
+}
+
+/*
+* Function: ms_set_interrupt_hook:
+* --------------------------------
+* Sets the function called when Ctrl+C or Ctrl+Z are pressed and there is 
+* no foreground job.
+*
+*  ctx: context of the minishell.
+*  hook: function to call or NULL, it is called out of the signal handler
+*        from the event loop.
+*
+*  returns: void.
+*/
+void ms_set_interrupt_hook(struct ms_context *ctx, void (*hook)(void))
+{
+    ctx->interrupt_hook = hook;
+}
+
+/*
+* Function: execute_line:
+* -----------------------
+* Executes a command list: commands separated by ";", "&&" and "||". The 
+* command after "&&" is only executed if the last status is 0 and the command
+* after "||" only if it is not 0, the skipped commands are not parsed. The 
+* statuses of the commands executed in the last chain are saved for 
+* $PIPESTATUS, like the statuses of a pipeline in other shells. The lines 
+* that start with a compound command (if, while...) or define a function are
+* compiled like a script.
+*
+*  line: pointer where the input introduced by stdin is stored.
+*
+*  returns: the exit status of the last command executed.
+*/
+int execute_line(char *line)
+{
+    int statuses[ARGS_SIZE];
+    int n_statuses = 0;
+    int op = LIST_SEQ;
+
+    // Updates the jobs list with the jobs reaped since the last line.
+    reap_drain();
+
+    // The lines with compound commands or functions are compiled.
+    if (script_needed(line))
+    {
+        return script_line(line);
+    }
+
+    // Executes the commands of the list.
+    while (line)
+    {
+        int next_op;
+        char *next = split_list(line, &next_op);
+        if (op == LIST_SEQ || (op == LIST_AND) == (ms->last_status == 0))
+        {
+            if (execute_command(line) && n_statuses < ARGS_SIZE)
+            {
+                statuses[n_statuses++] = ms->last_status;
+            }
+        }
+        // Saves the statuses when the chain ends.
+        if (next_op == LIST_SEQ && n_statuses)
+        {
+            memcpy(ms->statuses, statuses, sizeof(int) * n_statuses);
+            ms->n_statuses = n_statuses;
+            n_statuses = 0;
+        }
+        line = next;
+        op = next_op;
+    }
+    return ms->last_status;
+}
+
+/*
+* Function: execute_command:
+* --------------------------
+* Runs the different functions that will prepare and execute a command and 
+* saves its exit status in last_status.
+*
+*  line: command to execute.
+*
+*  returns: 1 if a command has been executed, 0 if the line was empty.
+*/
+int execute_command(char *line)
+{
+    int executed = 0;
+
+    // Allocates memory for the array of pointers to tokens.
+    char **tokens = malloc(sizeof(char *) * ARGS_SIZE);
+
+    // Checks if it has been allocated correctly.
+    if (tokens)
+    {
+        // Obtains the tokens and executes them.
+        trace_event('B', "parse", "", 0);
+        int ntokens = parse_args(tokens, line);
+        trace_event('E', "parse", "", ntokens);
+        executed = execute_args(tokens);
+        free(tokens);
+    }
+    return executed;
+}
+
+/*
+* Function: execute_args:
+* -----------------------
+* Replaces the alias of the first token with its text and the command 
+* substitutions of the tokens with their output, then executes the command
+* and saves its exit status in last_status. It is used by execute_command 
+* and by the scripts, that keep their commands divided in tokens.
+*
+*  tokens: pointer array with the tokens of the command, ended with NULL. The
+*          tokens can be modified.
+*
+*  returns: 1 if a command has been executed, 0 if there were no tokens.
+*/
+int execute_args(char **tokens)
+{
+    int executed = 0;
+    int last = ms->exec_next;
+    ms->exec_next = 0;
+
+    // Replaces the alias with its text.
+    char *aliased[ARGS_SIZE];
+    char *alias = NULL;
+    if (tokens[0])
+    {
+        tokens = alias_expand(tokens, aliased, &alias);
+    }
+    // Replaces the command substitutions with their output. If there are no 
+    // arguments then skip.
+    struct capture fields = {NULL, 0, 0};
+    char **args = tokens[0] ? expand_args(tokens, &fields) : NULL;
+    if (tokens[0] && !args)
+    {
+        ms->last_status = EXIT_FAILURE;
+        executed = 1;
+    }
+    else if (args && args[0])
+    {
+        executed = 1;
+
+        // Allocates memory for the char array command and checks it.
+        char *command = malloc(sizeof(char) * COMMAND_LINE_SIZE);
+        if (command)
+        {
+            // Groups the line with all tokens.
+            join_args(args, command);
+
+            // Checks if it is an internal command, if not continue.
+            trace_event('B', "builtin", args[0], 0);
+            int external = check_internal(args);
+            trace_event('E', "builtin", args[0], !external);
+            if (external)
+            {
+                // Checks if it is a background command.
+                int bkg = is_background(args);
+
+                // The last command of a script replaces the minishell, it 
+                // only returns if the command does not exist.
+                if (last && !bkg && exec_allowed())
+                {
+                    ms->last_status = exec_command(args);
+                }
+                // Creates the son and waits for it if it is foreground.
+                else
+                {
+                    pid_t pid = launch_job(args, command, bkg, NULL);
+                    ms->last_status = pid > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+                    if (pid > 0 && !bkg)
+                    {
+                        ms->last_status = wait_foreground(command);
+                    }
+                }
+            }
+            // Liberates memory for the command.
+            free(command);
+        }
+    }
+    // Liberates the memory for the arguments.
+    if (args != tokens)
+    {
+        free(args);
+    }
+    free(fields.data);
+    free(alias);
+    return executed;
+}
+
+/*
+* Function: launch_job:
+* ---------------------
+* Creates a son that executes the external command in args. The father adds 
+* the son to the jobs_list if it is a background job, otherwise it is set as 
+* the foreground job. SIGCHLD is blocked until the son has been registered so 
+* the reaper always finds it.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*  command: command line shown in the jobs_list.
+*  bkg: 1 if it is a background job, 0 if it is a foreground job.
+*  options: limits applied to the son or NULL.
+*
+*  returns: the pid of the son or -1 if it could not be created.
+*/
+pid_t launch_job(char **args, char *command, int bkg,
+                 struct launch_options *options)
+{
+    // Chooses a CPU for the background jobs if the automatic policy is on.
+    struct launch_options automatic;
+    int cpu = -1;
+    if (bkg && ms->pin_policy != PIN_OFF && !(options && options->has_cpus))
+    {
+        cpu = pin_choose_cpu();
+        if (cpu >= 0)
+        {
+            if (options)
+            {
+                automatic = *options;
+            }
+            else
+            {
+                memset(&automatic, 0, sizeof(automatic));
+            }
+            CPU_ZERO(&automatic.cpus);
+            CPU_SET(cpu, &automatic.cpus);
+            automatic.has_cpus = 1;
+            options = &automatic;
+        }
+    }
+    // Blocks SIGCHLD until the son is registered.
+    sigset_t mask, old_mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, &old_mask);
+
+    // Creates a new thread and returns the son's pid. The commands without
+    // options use a son of the pool if there is one. The output buffered by
+    // the minishell is written before, so the son does not write it again.
+    fflush(NULL);
+    trace_event('B', "fork", args[0], 0);
+    pid_t pid = options ? -1 : pool_launch(args);
+    if (pid < 0)
+    {
+        pid = fork();
+    }
+
+    // If it is the father process then execute this.
+    if (pid > 0)
+    {
+        trace_event('E', "fork", args[0], pid);
+        trace_event('b', "job", command, pid);
+        ms->n_sons++;
+
+        // If it is a background job then add it to jobs_list, the jobs of a
+        // batch are not the last background job.
+        if (bkg)
+        {
+            int batch = options && options->batch;
+            if (batch)
+            {
+                setpgid(pid, pid);
+            }
+            else
+            {
+                ms->last_bg_pid = pid;
+            }
+            int position = jobs_list_add(pid, EXECUTED, command, 0);
+            if (position > 0)
+            {
+                ms->jobs_list[position].cpu = cpu;
+                ms->jobs_list[position].batch = batch;
+            }
+        }
+        else
+        {
+            // Sets values for the foreground job.
+            ms->jobs_list[FOREGROUND].pid = pid;
+            ms->jobs_list[FOREGROUND].id = 0;
+            ms->jobs_list[FOREGROUND].status = EXECUTED;
+            strcpy(ms->jobs_list[FOREGROUND].command_line, command);
+        }
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    }
+    // If it is the son process then execute this.
+    else if (pid == 0)
+    {
+        // Sets ignore for SIGTSTP and SIGINT.
+        signal(SIGTSTP, SIG_IGN); 
+        signal(SIGINT, SIG_IGN);  
+
+        // Sets standard action for SIGCHILD and SIGPIPE.
+        signal(SIGCHLD, SIG_DFL);
+        signal(SIGPIPE, SIG_DFL);
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
+
+        // Applies the limits of the son and closes the descriptors of the
+        // minishell when the command is executed.
+        if (options && apply_launch_options(options))
+        {
+            _exit(EXIT_FAILURE);
+        }
+        close_inherited_fds();
+        // Executes the commands of a subshell, its last command replaces
+        // the son.
+        if (options && options->script)
+        {
+            subshell_init();
+            ms->exec_script = options->script;
+            script_execute(options->script);
+            exit(ms->last_status);
+        }
+        // Looks for redirection in the command line.
+        is_output_redirection(args);
+
+        // Executes the command introduced using args.
+        trace_event('i', "exec", args[0], 0);
+        if (execvp(args[0], args))
+        {
+            // If there is an error then shows it and exits without writing
+            // the buffers of the minishell.
+            fprintf(stderr,"%s: no se encontró la orden.\n", args[0]);
+            _exit(EXIT_FAILURE);
+        }
+        // Exits once the command has been executed.
+        _exit(EXIT_SUCCESS);
+    }
+    else
+    {
+        // The son could not be created, the minishell (or the program that
+        // uses the library) continues.
+        perror("fork");
+        trace_event('E', "fork", args[0], -1);
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    }
+    return pid;
+}
+
+/*
+* Function: launch_prefixed:
+* --------------------------
+* Launches the command that follows an internal command used as prefix (for 
+* example timeout or ulimit). The whole line is shown in the jobs_list.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*  cmd: first token of the command to execute inside args.
+*  options: limits applied to the son or NULL.
+*  bkg: pointer where 1 is stored if it is a background job, otherwise 0.
+*
+*  returns: the pid of the son or -1 if there is no memory or the son could
+*           not be created.
+*/
+pid_t launch_prefixed(char **args, char **cmd, struct launch_options *options,
+                      int *bkg)
+{
+    // Allocates memory for the command line shown in jobs.
+    char *command = malloc(sizeof(char) * COMMAND_LINE_SIZE);
+    if (!command)
+    {
+        return -1;
+    }
+    join_args(args, command);
+
+    // Launches the command.
+    *bkg = is_background(cmd);
+    pid_t pid = launch_job(cmd, command, *bkg, options);
+    free(command);
+    return pid;
+}
+
+/*
+* Function: apply_launch_options:
+* -------------------------------
+* Applies the limits, the CPU affinity and the descriptors to the current 
+* process. It is used by the son before executing the command.
+*
+*  options: limits, CPUs and descriptors to apply.
+*
+*  returns: exit success or exit failure if a limit could not be changed.
+*/
+int apply_launch_options(struct launch_options *options)
+{
+    // The jobs of a batch do not read the terminal and can be stopped 
+    // with all their sons.
+    if (options->batch)
+    {
+        setpgid(0, 0);
+    }
+    int input = options->has_input ? options->input : -1;
+    if (options->batch && !options->has_input)
+    {
+        input = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+    if (input > 0)
+    {
+        dup2(input, 0);
+        close(input);
+    }
+    if (options->has_output &&
+        (dup2(options->output[0], 1) < 0 || dup2(options->output[1], 2) < 0))
+    {
+        perror("dup2");
+        return EXIT_FAILURE;
+    }
+    // Pins the process to the CPUs.
+    if (options->has_cpus &&
+        sched_setaffinity(0, sizeof(cpu_set_t), &options->cpus))
+    {
+        perror("sched_setaffinity");
+        return EXIT_FAILURE;
+    }
+    struct rlimit limit;
+    for (int i = 0; i < options->n_limits; i++)
+    {
+        // Changes the soft and or the hard limit keeping the other one.
+        getrlimit(options->resources[i], &limit);
+        if (options->soft)
+        {
+            limit.rlim_cur = options->values[i];
+        }
+        if (options->hard)
+        {
+            limit.rlim_max = options->values[i];
+        }
+        if (setrlimit(options->resources[i], &limit))
+        {
+            perror("setrlimit");
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: close_inherited_fds:
+* ------------------------------
+* Marks as close on exec all the descriptors above stderr except the ones of
+* the keep list, so an executed command only receives stdin, stdout, stderr
+* and the descriptors kept for it. close_range is used in the ranges between
+* the kept descriptors; if it does not exist, the open descriptors are read
+* from /proc/self/fd.
+*
+*  returns: void.
+*/
+void close_inherited_fds()
+{
+    // Sorts the keep list.
+    int keep[KEEP_FDS];
+    int n_keep = ms->n_keep_fds;
+    memcpy(keep, ms->keep_fds, sizeof(int) * n_keep);
+    for (int i = 1; i < n_keep; i++)
+    {
+        for (int j = i; j > 0 && keep[j - 1] > keep[j]; j--)
+        {
+            int aux = keep[j];
+            keep[j] = keep[j - 1];
+            keep[j - 1] = aux;
+        }
+    }
+    // Marks the ranges between the kept descriptors.
+    unsigned int first = 3;
+    int result = 0;
+    for (int i = 0; i <= n_keep && !result; i++)
+    {
+        unsigned int last = i < n_keep ? (unsigned int)keep[i] - 1 : ~0U;
+        if (first <= last)
+        {
+            result = close_range(first, last, CLOSE_RANGE_CLOEXEC);
+        }
+        if (i < n_keep && (unsigned int)keep[i] + 1 > first)
+        {
+            first = keep[i] + 1;
+        }
+    }
+    if (!result)
+    {
+        return;
+    }
+    // Kernels without close_range.
+    DIR *dir = opendir("/proc/self/fd");
+    struct dirent *entry;
+    while (dir && (entry = readdir(dir)))
+    {
+        int fd = atoi(entry->d_name);
+        int kept = fd < 3 || fd == dirfd(dir);
+        for (int i = 0; i < n_keep && !kept; i++)
+        {
+            kept = fd == keep[i];
+        }
+        if (!kept)
+        {
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+    }
+    if (dir)
+    {
+        closedir(dir);
+    }
+}
+
+/*
+* Function: keep_fd_add:
+* ----------------------
+* Adds a descriptor to the keep list, so the executed commands receive it.
+* stdin, stdout and stderr are always received and are not added.
+*
+*  fd: descriptor to keep.
+*
+*  returns: void.
+*/
+void keep_fd_add(int fd)
+{
+    for (int i = 0; i < ms->n_keep_fds; i++)
+    {
+        if (ms->keep_fds[i] == fd)
+        {
+            return;
+        }
+    }
+    if (fd > 2 && ms->n_keep_fds < KEEP_FDS)
+    {
+        ms->keep_fds[ms->n_keep_fds++] = fd;
+    }
+}
+
+/*
+* Function: keep_fd_remove:
+* -------------------------
+* Removes a descriptor from the keep list, for example when it is closed.
+*
+*  fd: descriptor that is no longer kept.
+*
+*  returns: void.
+*/
+void keep_fd_remove(int fd)
+{
+    for (int i = 0; i < ms->n_keep_fds; i++)
+    {
+        if (ms->keep_fds[i] == fd)
+        {
+            ms->keep_fds[i] = ms->keep_fds[--ms->n_keep_fds];
+            return;
+        }
+    }
+}
+
+/*
+* Function: exec_command:
+* -----------------------
+* Replaces the minishell with an external command without creating a son. 
+* execve resets the signal handlers of the minishell and the descriptors are
+* closed like in the son of launch_job. It is used by exec and by the last 
+* command of a script.
+*
+*  args: pointer array with the command and its arguments, it can have an 
+*        output redirection.
+*
+*  returns: exit failure if the command could not be executed, otherwise it
+*           does not return.
+*/
+int exec_command(char **args)
+{
+    // Ends the sons of the pool, writes the pending output and saves 
+    // stdout in case the command can not be executed.
+    pool_flush();
+    fflush(stdout);
+    fflush(stderr);
+    int saved = fcntl(1, F_DUPFD_CLOEXEC, USER_FDS);
+    is_output_redirection(args);
+    signal(SIGPIPE, SIG_DFL);
+    close_inherited_fds();
+
+    // Executes the command introduced using args.
+    trace_event('i', "exec", args[0], 0);
+    execvp(args[0], args);
+    fprintf(stderr, "%s: no se encontró la orden.\n", args[0]);
+
+    // Restores stdout of the minishell.
+    if (saved >= 0)
+    {
+        dup2(saved, 1);
+        close(saved);
+    }
+    return EXIT_FAILURE;
+}
+
+/*
+* Function: exec_allowed:
+* -----------------------
+* Checks if the minishell can be replaced by its last command: it is not 
+* needed after it by background or stopped jobs, queued jobs, timeouts, the
+* control socket or the notifications of finished jobs.
+*
+*  returns: 1 if the minishell can be replaced, otherwise 0.
+*/
+int exec_allowed()
+{
+    reap_drain();
+    return !ms->n_jobs && !ms->n_queue && !ms->n_timers && !ms->n_notify &&
+           ms->listen_fd < 0 && !ms->interrupted;
+}
+
+/*
+* Function: close_exec_fds:
+* -------------------------
+* Closes the descriptors above stderr marked as close on exec, that belong 
+* to the minishell, in a son that does not execute a command yet.
+*
+*  except: descriptor that is not closed or -1.
+*
+*  returns: void.
+*/
+void close_exec_fds(int except)
+{
+    DIR *dir = opendir("/proc/self/fd");
+    struct dirent *entry;
+    while (dir && (entry = readdir(dir)))
+    {
+        int fd = atoi(entry->d_name);
+        int flags = fcntl(fd, F_GETFD);
+        if (fd > 2 && fd != dirfd(dir) && fd != except && flags >= 0 &&
+            (flags & FD_CLOEXEC))
+        {
+            close(fd);
+        }
+    }
+    if (dir)
+    {
+        closedir(dir);
+    }
+}
+
+/*
+* Function: subshell_init:
+* ------------------------
+* Prepares a son that executes commands of the minishell (a subshell). It 
+* gets its own event loop and an empty jobs list, so it only waits for its
+* own sons, and it forgets the queue, the timeouts and the control socket of
+* the father.
+*
+*  returns: void.
+*/
+void subshell_init()
+{
+    // Closes the descriptors that an executed command would not receive 
+    // (close on exec): the event loop, the control socket and the pipes of
+    // other jobs, that would not reach the end of file.
+    close_exec_fds(-1);
+    ms->event_fd = ms->timer_fd = ms->watched_fd = ms->listen_fd = -1;
+    ms->record_fd = -1;
+    ms->profile = NULL;
+    ms->n_watching = 0;
+    for (int i = 0; i < N_CLIENTS; i++)
+    {
+        ms->clients[i].fd = -1;
+    }
+    ms->n_pool = ms->pool_size = 0;
+
+    // Forgets the jobs of the father.
+    for (int i = 0; i < ms->n_queue; i++)
+    {
+        free(ms->queue[i].command_line);
+        free(ms->queue[i].args);
+    }
+    ms->n_queue = 0;
+    ms->n_timers = 0;
+    ms->n_jobs = 0;
+    ms->jobs_used = 1;
+    ms->n_free = 0;
+    ms->next_job_id = 1;
+    ms->reaped.head = ms->reaped.tail = 0;
+    ms->reaped.overflow = 0;
+    ms->n_finished = 0;
+    ms->n_notify = ms->n_notify_failed = ms->n_notify_signaled = 0;
+    ms->notify_start = 0;
+    ms->interrupted = 0;
+    ms->pending_newline = ms->pending_prompt = 0;
+    ms->minishell.pid = getpid();
+
+    // Creates the event loop and waits for the sons with the reaper.
+    event_init();
+    signal(SIGCHLD, reaper);
+}
+
+/*
+* Function: wait_foreground:
+* --------------------------
+* Waits in the event loop until the foreground job finishes or is stopped and 
+* then resets the foreground. A stopped job is added to the jobs_list.
+*
+*  command: command line of the foreground job.
+*
+*  returns: the exit status of the job, 128 + SIGTSTP if it has been stopped.
+*/
+int wait_foreground(char *command)
+{
+    // Waits until the foreground job is finished.
+    trace_event('B', "wait", command, ms->jobs_list[FOREGROUND].pid);
+    while (ms->jobs_list[FOREGROUND].pid &&
+           ms->jobs_list[FOREGROUND].status != STOPPED)
+    {
+        event_wait(-1);
+    }
+    trace_event('E', "wait", command, 0);
+
+    // Adds the stopped job to the jobs list keeping its id.
+    int status = exit_status(ms->foreground_status);
+    if (ms->jobs_list[FOREGROUND].pid)
+    {
+        jobs_list_add(ms->jobs_list[FOREGROUND].pid, STOPPED,
+                      ms->jobs_list[FOREGROUND].command_line,
+                      ms->jobs_list[FOREGROUND].id);
+        status = 128 + SIGTSTP;
+    }
+
+    // Resets values for the foreground job.
+    ms->jobs_list[FOREGROUND].pid = ms->foreground.pid;
+    ms->jobs_list[FOREGROUND].id = 0;
+    ms->jobs_list[FOREGROUND].status = ms->foreground.status;
+    strcpy(ms->jobs_list[FOREGROUND].command_line, ms->foreground.command_line);
+    return status;
+}
+
+/*
+* Function: check_internal:
+* -------------------------
+* Checks whether the command is internal or not. If it is internal, executes 
+* the command, saves its exit status in last_status and returns exit success.
+* Otherwise, returns exit failure.
+*  
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: exit success if it is an internal command, otherwise exit failure.
+*/
+int check_internal(char **args)
+{
+    // Looks for the command in the table, the functions go first.
+    struct command_entry *entry = command_find(args[0]);
+    if (entry && entry->function)
+    {
+        ms->last_status = function_call(entry, args);
+    }
+    else if (entry && entry->builtin)
+    {
+        ms->last_status = ms->profile ? profile_builtin(entry, args) :
+                          entry->builtin(args);
+    }
+    else
+    {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: is_internal:
+* ----------------------
+* Checks whether a command is internal without executing it.
+*
+*  name: name of the command.
+*
+*  returns: 1 if it is an internal command, otherwise 0.
+*/
+int is_internal(const char *name)
+{
+    struct command_entry *entry = command_find(name);
+    return entry && (entry->function || entry->builtin);
+}
+
+/*
+* Function: reaper:
+* -----------------
+* Executed when a son terminates. It only uses async-signal-safe operations:
+* the foreground job is reset and the background jobs are added to the reap 
+* queue, reap_drain updates the jobs_list later out of the signal handler. If
+* the queue is full the remaining sons are not reaped until it is drained. 
+* Only the sons in the jobs_list are reaped, the other sons of the program 
+* that uses the library are left for it.
+*
+*  signum: number of the signal.
+*
+*  returns: void.
+*/
+void reaper(int signum)
+{
+    // Variables for the ending job.
+    int status;
+    pid_t pid;
+    trace_event('i', "signal", "SIGCHLD", signum);
+
+    // Checks if a job has ended while there is space in the queue. The 
+    // first finished son is looked at without reaping it; if it is not a 
+    // job, the jobs are checked one by one.
+    int scan = 0;
+    int position = 0;
+    while (1)
+    {
+        unsigned long head = ms->reaped.head;
+        if (head - __atomic_load_n(&ms->reaped.tail, __ATOMIC_ACQUIRE) ==
+            REAP_QUEUE_SIZE)
+        {
+            ms->reaped.overflow = 1;
+            break;
+        }
+        siginfo_t info;
+        info.si_pid = 0;
+        if (!scan &&
+            (waitid(P_ALL, 0, &info, WEXITED | WNOHANG | WNOWAIT) < 0 ||
+             !info.si_pid))
+        {
+            break;
+        }
+        if (!scan && jobs_list_find(info.si_pid) < 0)
+        {
+            scan = 1;
+        }
+        if (scan)
+        {
+            // Next job of the jobs_list that has ended.
+            pid = 0;
+            for (; position < ms->jobs_used && pid <= 0; position++)
+            {
+                pid = ms->jobs_list[position].pid;
+                pid = pid > 0 && ms->jobs_list[position].status != FINALIZED ?
+                      waitpid(pid, &status, WNOHANG) : 0;
+            }
+            if (pid <= 0)
+            {
+                break;
+            }
+        }
+        else if ((pid = waitpid(info.si_pid, &status, WNOHANG)) <= 0)
+        {
+            break;
+        }
+        trace_event('i', "reap", "", status);
+        trace_event('e', "job", "", pid);
+
+        // If it is a foreground job it is finished.
+        if (pid == ms->jobs_list[FOREGROUND].pid)
+        {
+            ms->foreground_status = status;
+            ms->jobs_list[FOREGROUND].pid = ms->foreground.pid;
+        }
+        // If it is a background job it is added to the queue.
+        else
+        {
+            ms->reaped.entries[head % REAP_QUEUE_SIZE].pid = pid;
+            ms->reaped.entries[head % REAP_QUEUE_SIZE].status = status;
+            __atomic_store_n(&ms->reaped.head, head + 1, __ATOMIC_RELEASE);
+        }
+    }
+    // Wakes up the event loop.
+    event_wake();
+    // Sets the signal SIGCHLD to the reaper function.
+    signal(SIGCHLD, reaper);
+}
+
+/*
+* Function: ctrlc:
+* ----------------
+* Executed when Ctrl+C is pressed killing the foreground process. It only 
+* uses async-signal-safe operations, the line break and the prompt are 
+* printed later by interrupt_drain.
+*
+*  signum: number of the signal.
+*
+*  returns: void.
+*/
+void ctrlc(int signum)
+{
+    trace_event('i', "signal", "SIGINT", signum);
+
+    // Check if there is a job in foreground.
+    if (ms->jobs_list[FOREGROUND].pid > ms->foreground.pid)
+    {
+        // Checks if it is not the minishell.
+        if (strcmp(ms->jobs_list[FOREGROUND].command_line,
+                   ms->minishell.command_line))
+        {
+            // If it is not the minishell then send SIGTERM to the job and 
+            // stops the script that is being executed.
+            kill(ms->jobs_list[FOREGROUND].pid, SIGTERM);
+            ms->interrupted = 1;
+            ms->pending_newline = 1;
+            event_wake();
+        }
+    }
+    else
+    {
+        // Interrupts wait, the prompt is printed again.
+        ms->interrupted = 1;
+        ms->pending_newline = 1;
+        ms->pending_prompt = 1;
+        event_wake();
+    }
+    // Sets SIGINT to the function ctrlc.
+    signal(SIGINT, ctrlc);
+}
+
+/*
+* Function ctrlz:
+* ---------------
+* Executed when Ctrl+Z is pressed. This function stops the foreground job
+* and allows the user to input new commands. Like ctrlc, the line break and
+* the prompt are printed later by interrupt_drain.
+*
+*  signum: number of the signal.
+*
+*  returns: void
+*/
+void ctrlz(int signum)
+{
+    trace_event('i', "signal", "SIGTSTP", signum);
+
+    // Check if there is a foreground job.
+    if (ms->jobs_list[FOREGROUND].pid != ms->foreground.pid)
+    {
+        // Checks if the foreground is not the minishell.
+        if (strcmp(ms->jobs_list[FOREGROUND].command_line,
+                   ms->minishell.command_line))
+        {
+            // Sends the signal to stop to the foreground job.
+            kill(ms->jobs_list[FOREGROUND].pid, SIGSTOP);
+
+            // Updates the stopped job, wait_foreground adds it to the jobs 
+            // list out of the signal handler.
+            ms->jobs_list[FOREGROUND].status = STOPPED;
+            ms->pending_newline = 1;
+            event_wake();
+        }
+    }
+    else
+    {
+        // The prompt is printed again.
+        ms->pending_newline = 1;
+        ms->pending_prompt = 1;
+        event_wake();
+    }
+    // Sets SIGSTP to the function ctrlz.
+    signal(SIGTSTP, ctrlz);
+}
+
+/*
+* Function: interrupt_drain:
+* --------------------------
+* Prints the line break of a Ctrl+C or Ctrl+Z and lets the program print the
+* prompt again, out of the signal handlers. It is called by the event loop,
+* like reap_drain.
+*
+*  returns: void.
+*/
+void interrupt_drain()
+{
+    if (ms->pending_newline)
+    {
+        ms->pending_newline = 0;
+        printf("\n");
+        fflush(stdout);
+    }
+    if (ms->pending_prompt)
+    {
+        ms->pending_prompt = 0;
+        if (ms->interrupt_hook)
+        {
+            ms->interrupt_hook();
+        }
+    }
+}
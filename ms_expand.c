@@ -0,0 +1,599 @@
+/*
+* Expansion of libminishell: parameters ($?, $!, $PIPESTATUS and environment
+* variables) and command substitution with $(...) and `...` in the tokens of 
+* the command lines and division of the result in fields.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#include "ms_internal.h"
+
+/*
+* Function: expand_args:
+* ----------------------
+* Replaces the parameters and each $(command) and `command` of the tokens with
+* their value or the output of the command and divides the result in fields 
+* by the blanks, tabs and new lines.
+* A token whose expansion is empty does not produce any field.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*  fields: buffer where the fields are stored, separated by '\0'.
+*
+*  returns: args if there is nothing to expand, a new pointer array allocated 
+*           with malloc or NULL if there is an error.
+*/
+char **expand_args(char **args, struct capture *fields)
+{
+    // Most lines do not have substitutions and are not copied.
+    int i = 0;
+    while (args[i] && !strchr(args[i], '$') && !strchr(args[i], '`'))
+    {
+        i++;
+    }
+    if (!args[i])
+    {
+        return args;
+    }
+    int nfields = 0;
+    for (i = 0; args[i]; i++)
+    {
+        // The tokens without substitutions are copied as they are.
+        if (!strchr(args[i], '$') && !strchr(args[i], '`'))
+        {
+            if (capture_append(fields, args[i], strlen(args[i]) + 1))
+            {
+                return NULL;
+            }
+            nfields++;
+            continue;
+        }
+        struct capture word = {NULL, 0, 0};
+        if (expand_word(args[i], &word))
+        {
+            free(word.data);
+            return NULL;
+        }
+        // Divides the expanded token in fields.
+        int open = 0;
+        for (size_t j = 0; j < word.length; j++)
+        {
+            char c = word.data[j];
+            if (c == ' ' || c == '\t' || c == '\n')
+            {
+                if (open)
+                {
+                    capture_append(fields, "", 1);
+                    open = 0;
+                }
+            }
+            else
+            {
+                nfields += !open;
+                open = 1;
+                capture_append(fields, &c, 1);
+            }
+        }
+        if (open)
+        {
+            capture_append(fields, "", 1);
+        }
+        free(word.data);
+    }
+    // Creates the pointer array once the buffer does not move any more.
+    char **expanded = malloc(sizeof(char *) * (nfields + 1));
+    if (!expanded)
+    {
+        perror("malloc");
+        return NULL;
+    }
+    char *field = fields->data;
+    for (i = 0; i < nfields; i++)
+    {
+        expanded[i] = field;
+        field += strlen(field) + 1;
+    }
+    expanded[nfields] = NULL;
+    return expanded;
+}
+
+/*
+* Function: expand_word:
+* ----------------------
+* Copies a token replacing the parameters with their value and each 
+* $(command) and `command` with the output of the command.
+*
+*  word: token to expand.
+*  output: buffer where the expanded token is stored, without '\0'.
+*
+*  returns: exit success or exit failure if there is an error.
+*/
+int expand_word(char *word, struct capture *output)
+{
+    char *ptr = word;
+    while (*ptr)
+    {
+        char *start = NULL;
+        char *end = NULL;
+
+        // Looks for the end of the command, $(...) can be nested.
+        if (ptr[0] == '$' && ptr[1] == '(')
+        {
+            int depth = 1;
+            start = ptr + 2;
+            end = start;
+            while (*end && depth)
+            {
+                depth += (*end == '(') - (*end == ')');
+                end++;
+            }
+            end = depth ? NULL : end - 1;
+        }
+        else if (ptr[0] == '`')
+        {
+            start = ptr + 1;
+            end = strchr(start, '`');
+        }
+        else if (ptr[0] == '$')
+        {
+            ptr += expand_parameter(ptr, output);
+            continue;
+        }
+        if (!start)
+        {
+            capture_append(output, ptr, 1);
+            ptr++;
+            continue;
+        }
+        if (!end)
+        {
+            fprintf(stderr, "Error: sustitución de orden sin cerrar\n");
+            return EXIT_FAILURE;
+        }
+        // Executes the command and adds its output without the last new lines.
+        size_t length = output->length;
+        char *command = strndup(start, end - start);
+        if (!command || command_substitution(command, output))
+        {
+            free(command);
+            return EXIT_FAILURE;
+        }
+        free(command);
+        while (output->length > length &&
+               output->data[output->length - 1] == '\n')
+        {
+            output->length--;
+        }
+        ptr = end + 1;
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: expand_parameter:
+* ---------------------------
+* Adds the value of the parameter that starts in text: $? (last status), $! 
+* (last background job), $PIPESTATUS (statuses of the last command list), 
+* ${PIPESTATUS[n]}, the arguments of the function in execution ($1...$9, 
+* ${n}, $# and $@ or $*) or an environment variable ($NAME or ${NAME}). A 
+* "$" that does not start a parameter is copied.
+*
+*  text: text that starts with "$".
+*  output: buffer where the value is added.
+*
+*  returns: the number of characters of the parameter.
+*/
+int expand_parameter(char *text, struct capture *output)
+{
+    char value[COMMAND_LINE_SIZE];
+    char name[COMMAND_LINE_SIZE];
+    int braces = text[1] == '{';
+    int length = 1 + braces;
+    int index = -1;
+
+    // Special parameters.
+    if (text[length] == '?' || text[length] == '!' || text[length] == '#')
+    {
+        snprintf(value, sizeof(value), "%d", text[length] == '?' ?
+                 ms->last_status : text[length] == '!' ? ms->last_bg_pid :
+                 ms->n_positional ? ms->n_positional - 1 : 0);
+        length++;
+    }
+    else if (text[length] == '@' || text[length] == '*')
+    {
+        // All the arguments of the function.
+        value[0] = '\0';
+        for (int i = 1; i < ms->n_positional; i++)
+        {
+            snprintf(value + strlen(value), sizeof(value) - strlen(value),
+                     "%s%s", i > 1 ? " " : "", ms->positional[i]);
+        }
+        length++;
+    }
+    else if (isdigit(text[length]))
+    {
+        // Argument of the function, without braces it only has one digit.
+        char *end = text + length + 1;
+        int position = braces ? strtol(text + length, &end, 10)
+                              : text[length] - '0';
+        snprintf(value, sizeof(value), "%s", position < ms->n_positional ?
+                 ms->positional[position] : !position ? 
+                 ms->minishell.command_line : "");
+        length = end - text;
+    }
+    else
+    {
+        // Reads the name and the index of ${PIPESTATUS[n]}.
+        int n = 0;
+        while ((text[length] == '_' || isalnum(text[length])) &&
+               n < COMMAND_LINE_SIZE - 1)
+        {
+            name[n++] = text[length++];
+        }
+        name[n] = '\0';
+        if (braces && text[length] == '[' && isdigit(text[length + 1]))
+        {
+            char *end;
+            index = strtol(text + length + 1, &end, 10);
+            length = *end == ']' ? end + 1 - text : length;
+        }
+        if (!n)
+        {
+            capture_append(output, "$", 1);
+            return 1;
+        }
+        if (!strcmp(name, "PIPESTATUS"))
+        {
+            // All the statuses or the status of the index.
+            value[0] = '\0';
+            for (int i = 0; i < ms->n_statuses; i++)
+            {
+                if (index < 0 || index == i)
+                {
+                    snprintf(value + strlen(value), 
+                             sizeof(value) - strlen(value), "%s%d",
+                             *value ? " " : "", ms->statuses[i]);
+                }
+            }
+        }
+        else
+        {
+            snprintf(value, sizeof(value), "%s", getenv(name) ? getenv(name)
+                                                              : "");
+        }
+    }
+    if (braces)
+    {
+        if (text[length] != '}')
+        {
+            capture_append(output, "$", 1);
+            return 1;
+        }
+        length++;
+    }
+    capture_append(output, value, strlen(value));
+    return length;
+}
+
+/*
+* Function: command_substitution:
+* -------------------------------
+* Executes a command list and adds its output to the buffer. A single 
+* command is executed by capture_command. A list or a compound command is 
+* executed by execute_line in one son, like a subshell, so a command sees 
+* the changes of the previous ones (cd, export...) and the minishell does 
+* not.
+*
+*  command: command list to execute, it can have substitutions.
+*  output: buffer where the output is added.
+*
+*  returns: exit success or exit failure if a command could not be executed.
+*/
+int command_substitution(char *command, struct capture *output)
+{
+    // split_list cuts the copy, the son executes the whole list.
+    char *copy = strdup(command);
+    if (!copy)
+    {
+        perror("strdup");
+        return EXIT_FAILURE;
+    }
+    int op;
+    int result;
+    if (!split_list(copy, &op) && !script_needed(copy))
+    {
+        result = capture_command(copy, output);
+    }
+    else
+    {
+        trace_event('B', "substitution", command, 0);
+        result = capture_son(NULL, command, output);
+        trace_event('E', "substitution", command, output->length);
+    }
+    free(copy);
+    return result;
+}
+
+/*
+* Function: capture_command:
+* --------------------------
+* Executes a command, adds its output to the buffer and saves its exit status
+* in last_status. Only the internal commands that do not change the 
+* minishell (jobs) are executed in it with the output in a memfd, without 
+* fork. The other internal commands (cd, export, ulimit, alias...) and the
+* functions are executed in a son, like a subshell, so their changes are 
+* lost. The external
+* commands are executed in a son and the output is read from a pipe.
+*
+*  command: command line to execute, it can have substitutions.
+*  output: buffer where the output is added.
+*
+*  returns: exit success or exit failure if the command could not be executed.
+*/
+int capture_command(char *command, struct capture *output)
+{
+    const char *in_process[] = {"jobs", NULL};
+    int result = EXIT_FAILURE;
+
+    // Divides the command in tokens and expands them.
+    char **tokens = malloc(sizeof(char *) * ARGS_SIZE);
+    if (!tokens)
+    {
+        return EXIT_FAILURE;
+    }
+    trace_event('B', "substitution", command, 0);
+    struct capture fields = {NULL, 0, 0};
+    char **args = parse_args(tokens, command) ? 
+                  expand_args(tokens, &fields) : tokens;
+    if (args && !args[0])
+    {
+        result = EXIT_SUCCESS;
+    }
+    else if (args)
+    {
+        // Runs the command in background as if it was in foreground.
+        is_background(args);
+        // A function is always executed in the son, even if it has the
+        // name of a command that is executed in the minishell.
+        struct command_entry *entry = command_find(args[0]);
+        int listed = 0;
+        for (int i = 0; in_process[i]; i++)
+        {
+            listed |= !strcmp(args[0], in_process[i]);
+        }
+        if (!listed || !entry || entry->function)
+        {
+            result = capture_son(args, NULL, output);
+        }
+        else
+        {
+            result = capture_internal(args, output);
+        }
+    }
+    trace_event('E', "substitution", command, output->length);
+    if (args != tokens)
+    {
+        free(args);
+    }
+    free(fields.data);
+    free(tokens);
+    return result;
+}
+
+/*
+* Function: capture_internal:
+* ---------------------------
+* Executes an internal command in the minishell with stdout in a memfd and
+* stores the output.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*  output: buffer where the output is stored.
+*
+*  returns: exit success or exit failure.
+*/
+int capture_internal(char **args, struct capture *output)
+{
+    // Creates the memfd and puts it as stdout.
+    int fd = memfd_create("ms_capture", MFD_CLOEXEC);
+    if (fd < 0)
+    {
+        perror("memfd_create");
+        return EXIT_FAILURE;
+    }
+    fflush(stdout);
+    int saved = fcntl(1, F_DUPFD_CLOEXEC, USER_FDS);
+    dup2(fd, 1);
+
+    // Executes the command and restores stdout.
+    check_internal(args);
+    fflush(stdout);
+    dup2(saved, 1);
+    close(saved);
+
+    // Reads the output from the beginning.
+    lseek(fd, 0, SEEK_SET);
+    int result = capture_read(fd, output);
+    close(fd);
+    return result;
+}
+
+/*
+* Function: capture_son:
+* ----------------------
+* Executes a command or a command list in a son with stdout in a pipe, 
+* stores the output and saves the exit status in last_status. SIGCHLD is 
+* blocked until the son has been waited so the reaper does not take it.
+*
+*  args: pointer array that storages all the tokens in a command line, NULL
+*        to execute line.
+*  line: command list executed by the son like a subshell if args is NULL.
+*  output: buffer where the output is stored.
+*
+*  returns: exit success or exit failure.
+*/
+int capture_son(char **args, char *line, struct capture *output)
+{
+    int pipe_fd[2];
+    if (pipe2(pipe_fd, O_CLOEXEC))
+    {
+        perror("pipe");
+        return EXIT_FAILURE;
+    }
+    // Blocks SIGCHLD until the son has been waited.
+    sigset_t mask, old_mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, &old_mask);
+
+    // The son must not write again the output buffered by the minishell.
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        // Ctrl+C ends the son, Ctrl+Z is ignored.
+        signal(SIGTSTP, SIG_IGN);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGCHLD, SIG_DFL);
+        signal(SIGPIPE, SIG_DFL);
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
+        dup2(pipe_fd[1], 1);
+        close_inherited_fds();
+
+        // The command lists and the internal commands are executed here, 
+        // in a subshell that does not share the jobs and the event loop of
+        // the minishell.
+        if (!args)
+        {
+            subshell_init();
+            execute_line(line);
+            fflush(stdout);
+            exit(ms->last_status);
+        }
+        if (!strcmp(args[0], "exit"))
+        {
+            exit(args[1] ? atoi(args[1]) : ms->last_status);
+        }
+        if (is_internal(args[0]))
+        {
+            subshell_init();
+            check_internal(args);
+            fflush(stdout);
+            exit(ms->last_status);
+        }
+        is_output_redirection(args);
+        execvp(args[0], args);
+        fprintf(stderr, "%s: no se encontró la orden.\n", args[0]);
+        _exit(EXIT_FAILURE);
+    }
+    close(pipe_fd[1]);
+    if (pid < 0)
+    {
+        perror("fork");
+        close(pipe_fd[0]);
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
+        return EXIT_FAILURE;
+    }
+    ms->n_sons++;
+    // Reads the output until the son closes the pipe and waits for it.
+    int result = capture_read(pipe_fd[0], output);
+    int status = 0;
+    close(pipe_fd[0]);
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+    {
+    }
+    ms->last_status = exit_status(status);
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    return result;
+}
+
+/*
+* Function: capture_read:
+* -----------------------
+* Reads a descriptor until the end and stores the data in the buffer, that
+* doubles its size when it is full.
+*
+*  fd: descriptor to read.
+*  output: buffer where the data is stored.
+*
+*  returns: exit success or exit failure.
+*/
+int capture_read(int fd, struct capture *output)
+{
+    while (1)
+    {
+        // Doubles the buffer when it is full.
+        if (output->length == output->size &&
+            capture_grow(output, output->size ? output->size * 2 : 256))
+        {
+            return EXIT_FAILURE;
+        }
+        ssize_t n = read(fd, output->data + output->length,
+                         output->size - output->length);
+        if (n > 0)
+        {
+            output->length += n;
+        }
+        else if (n == 0)
+        {
+            return EXIT_SUCCESS;
+        }
+        else if (errno != EINTR)
+        {
+            perror("read");
+            return EXIT_FAILURE;
+        }
+    }
+}
+
+/*
+* Function: capture_append:
+* -------------------------
+* Adds data at the end of the buffer, doubling its size if it is needed.
+*
+*  output: buffer where the data is stored.
+*  data: data to add.
+*  length: number of bytes to add.
+*
+*  returns: exit success or exit failure if there is no memory.
+*/
+int capture_append(struct capture *output, const char *data, size_t length)
+{
+    size_t size = output->size ? output->size : 256;
+    while (size < output->length + length)
+    {
+        size *= 2;
+    }
+    if (size != output->size && capture_grow(output, size))
+    {
+        return EXIT_FAILURE;
+    }
+    memcpy(output->data + output->length, data, length);
+    output->length += length;
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: capture_grow:
+* -----------------------
+* Changes the size of the buffer.
+*
+*  output: buffer to change.
+*  size: new size in bytes.
+*
+*  returns: exit success or exit failure if there is no memory.
+*/
+int capture_grow(struct capture *output, size_t size)
+{
+    char *data = realloc(output->data, size);
+    if (!data)
+    {
+        perror("realloc");
+        return EXIT_FAILURE;
+    }
+    output->data = data;
+    output->size = size;
+    return EXIT_SUCCESS;
+}
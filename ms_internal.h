@@ -0,0 +1,1074 @@
+/*
+* Internal definitions of libminishell shared by all its modules: constants,
+* structures, the context of the minishell and the function headers.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#ifndef MS_INTERNAL_H
+#define MS_INTERNAL_H
+
+// Constants:
+#define _GNU_SOURCE
+#define COMMAND_LINE_SIZE 1024
+#define ARGS_SIZE 64
+#define N_JOBS 64
+#define FOREGROUND 0
+#define EXECUTED 'E'
+#define STOPPED 'D'
+#define FINALIZED 'F'
+#define QUEUED 'Q'
+#define TRACE_EVENTS 65536
+#define TRACE_DETAIL_SIZE 32
+#define EVENTS_SIZE 16
+#define N_LIMITS 5
+#define PIN_OFF 0
+#define PIN_ROUND_ROBIN 1
+#define PIN_LEAST_LOADED 2
+#define NODES_PATH "/sys/devices/system/node"
+#define QUEUE_FIFO 0
+#define QUEUE_PRIORITY 1
+#define N_CLIENTS 64
+#define EVENT_COMMAND_SIZE 112
+#define N_FINISHED 64
+#define REAP_QUEUE_SIZE 4096
+#define NOTIFY_DETAIL 4
+#define LIST_SEQ 0
+#define LIST_AND 1
+#define LIST_OR 2
+#define NODE_COMMAND 0
+#define NODE_LIST 1
+#define NODE_AND 2
+#define NODE_OR 3
+#define NODE_IF 4
+#define NODE_WHILE 5
+#define NODE_UNTIL 6
+#define NODE_FOR 7
+#define NODE_CASE 8
+#define NODE_PATTERN 9
+#define NODE_BREAK 10
+#define NODE_CONTINUE 11
+#define NODE_FUNCTION 12
+#define NODE_RETURN 13
+#define TOKEN_END 0
+#define TOKEN_WORD 1
+#define TOKEN_NEWLINE 2
+#define TOKEN_SEMI 3
+#define TOKEN_DSEMI 4
+#define TOKEN_AND 5
+#define TOKEN_OR 6
+#define TOKEN_PIPE 7
+#define TOKEN_LPAREN 8
+#define TOKEN_RPAREN 9
+#define COMMANDS_SIZE 64
+#define FUNCTION_DEPTH 256
+#define CACHE_MAGIC "MSCACHE1"
+#define CACHE_KEY_FILES 16
+#define CACHE_ENV 16
+#define RECORD_MAGIC "MSREC001"
+#define BATCH_WINDOW 128
+#define KEEP_FDS 16
+#define USER_FDS 10
+#define POOL_SIZE 16
+#define PROFILE_SIZE 1024
+#define PROFILE_DEPTH 64
+#define PROFILE_REPORT 30
+#define PROFILE_LINE 0
+#define PROFILE_BUILTIN 1
+#define PROFILE_STACK 2
+
+// Libraries:
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/resource.h>
+#include <sched.h>
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <fnmatch.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <linux/close_range.h>
+#include "minishell.h"
+
+/* 
+* Structure for the storage of a job:
+* -----------------------------------
+*  pid: number that indentifies a job, 0 if the position is free.
+*  id: number of the job shown to the user (%n), it does not change.
+*  status: it can be Executed, Stopped, Finalized.
+*  command_line: command name and his arguments.
+*  cpu: CPU assigned by the automatic pin policy, -1 if there is none.
+*  batch: 1 if the job belongs to a batch, that collects it instead of the 
+*         notifications.
+*  wait_status: status returned by waitpid once a job of a batch has 
+*         finished (status Finalized).
+*/
+struct info_process
+{
+    pid_t pid;
+    int id;
+    char status;
+    char command_line[COMMAND_LINE_SIZE];
+    int cpu;
+    int batch;
+    int wait_status;
+};
+
+/*
+* Structure for the storage of a trace event:
+* -------------------------------------------
+*  seq: slot number plus one once the event is complete, 0 while writing it.
+*  ts: monotonic timestamp in nanoseconds.
+*  tid: pid of the process that recorded the event.
+*  phase: chrome trace phase (B begin, E end, i instant, b/e async job).
+*  name: static name of the event.
+*  arg: numeric argument (signal, status, pid...).
+*  detail: short text for the event (command, builtin name...).
+*/
+struct trace_event
+{
+    unsigned long seq;
+    long long ts;
+    pid_t tid;
+    char phase;
+    const char *name;
+    long arg;
+    char detail[TRACE_DETAIL_SIZE];
+};
+
+/*
+* Structure for the trace ring buffer:
+* ------------------------------------
+*  head: next slot to be written, it only grows.
+*  enabled: 1 if the events are being recorded.
+*  events: circular buffer of events.
+*/
+struct trace_ring
+{
+    unsigned long head;
+    int enabled;
+    struct trace_event events[TRACE_EVENTS];
+};
+
+/*
+* Structure for the storage of a timeout:
+* ---------------------------------------
+*  deadline: monotonic time in nanoseconds when the signal is sent.
+*  pid: job that receives the signal.
+*  signal: signal to send when the deadline expires.
+*  kill_after: nanoseconds to wait after the signal before sending SIGKILL, 
+*              0 if SIGKILL is not sent.
+*/
+struct timer_entry
+{
+    long long deadline;
+    pid_t pid;
+    int signal;
+    long long kill_after;
+};
+
+/*
+* Structure for the limits of a son:
+* ----------------------------------
+*  n_limits: number of limits to apply.
+*  resources: resources (RLIMIT_*) to change.
+*  values: new value for each resource.
+*  soft: 1 if the soft limit is changed.
+*  hard: 1 if the hard limit is changed.
+*  has_cpus: 1 if the son must be pinned to cpus.
+*  cpus: CPUs where the son can be executed.
+*  has_output: 1 if stdout and stderr of the son are replaced.
+*  output: descriptors used as stdout and stderr of the son.
+*  has_input, input: 1 if stdin of the son is replaced and its descriptor.
+*  batch: 1 if the son is a job of a batch: it has its own process group and
+*         stdin is /dev/null if it is not replaced.
+*  script: commands executed by the son as a subshell instead of args, or 
+*         NULL.
+*/
+struct launch_options
+{
+    int n_limits;
+    int resources[N_LIMITS];
+    rlim_t values[N_LIMITS];
+    int soft;
+    int hard;
+    int has_cpus;
+    cpu_set_t cpus;
+    int has_output;
+    int output[2];
+    int has_input;
+    int input;
+    int batch;
+    struct script_node *script;
+};
+
+/*
+* Structure for the description of a limit:
+* -----------------------------------------
+*  option: letter of the option in ulimit.
+*  resource: resource (RLIMIT_*).
+*  unit: bytes of a unit of the option, 1 if it is not measured in bytes.
+*  name: description of the limit.
+*/
+struct limit_info
+{
+    char option;
+    int resource;
+    rlim_t unit;
+    const char *name;
+};
+
+/*
+* Structure for a job waiting in the queue of submit:
+* ---------------------------------------------------
+*  priority: the jobs with higher priority are executed first.
+*  seq: order of arrival, used for FIFO and between equal priorities.
+*  command_line: command line of the job, shown by jobs.
+*  args: arguments of the job, already expanded by submit and ended with 
+*        "&", allocated in a single block.
+*/
+struct queue_entry
+{
+    int priority;
+    unsigned long seq;
+    char *command_line;
+    char **args;
+};
+
+/*
+* Structure for a client of the control socket:
+* ---------------------------------------------
+*  fd: descriptor of the connection, -1 if the position is free.
+*  watching: 1 if the client receives the events of finished jobs.
+*  used: number of characters stored in buffer.
+*  buffer: characters received that do not form a whole line yet.
+*/
+struct control_client
+{
+    int fd;
+    int watching;
+    int used;
+    char buffer[COMMAND_LINE_SIZE];
+};
+
+/*
+* Structure for the event of a finished job:
+* ------------------------------------------
+*  pid: pid of the finished job.
+*  status: status returned by waitpid.
+*  id: id that the job had in jobs_list.
+*  command_line: beginning of the command line of the job.
+*/
+struct job_event
+{
+    pid_t pid;
+    int status;
+    int id;
+    char command_line[EVENT_COMMAND_SIZE];
+};
+
+/*
+* Structure for a finished background job:
+* ----------------------------------------
+*  pid: pid of the job.
+*  status: status returned by waitpid.
+*  waited: 1 if wait has returned the status of the job, only used in the 
+*          finished jobs of the context.
+*/
+struct finished_job
+{
+    pid_t pid;
+    int status;
+    int waited;
+};
+
+/*
+* Structure for the queue of jobs reaped by the reaper:
+* -----------------------------------------------------
+* Lock-free queue with a single producer (the reaper, in signal context) and 
+* a single consumer (reap_drain, out of signal context).
+*
+*  head: next position written by the reaper, it only grows.
+*  tail: next position read by reap_drain, it only grows.
+*  overflow: 1 if the reaper stopped reaping because the queue was full.
+*  entries: circular buffer of reaped jobs.
+*/
+struct reap_queue
+{
+    unsigned long head;
+    unsigned long tail;
+    volatile sig_atomic_t overflow;
+    struct finished_job entries[REAP_QUEUE_SIZE];
+};
+
+/*
+* Structure for the output of a command substitution:
+* ---------------------------------------------------
+*  data: bytes of the output, allocated with malloc.
+*  length: number of bytes stored.
+*  size: number of bytes allocated, it doubles when it is full.
+*/
+struct capture
+{
+    char *data;
+    size_t length;
+    size_t size;
+};
+
+/*
+* Structure for the header of an entry of the cache:
+* --------------------------------------------------
+* The entry is the header followed by the key and the output of the command.
+*
+*  magic: CACHE_MAGIC, to detect files that are not entries.
+*  status: exit status of the command.
+*  created: time when the entry was stored, in nanoseconds since the epoch.
+*  key_length: number of bytes of the key.
+*  output_length: number of bytes of the output.
+*/
+struct cache_header
+{
+    char magic[8];
+    int status;
+    long long created;
+    uint64_t key_length;
+    uint64_t output_length;
+};
+
+/*
+* Structure for the header of a session recorded with record:
+* -----------------------------------------------------------
+*  magic: RECORD_MAGIC, to detect files that are not sessions.
+*  started: time when the recording started, in nanoseconds since the epoch.
+*/
+struct record_header
+{
+    char magic[8];
+    long long started;
+};
+
+/*
+* Structure for a line of a recorded session:
+* -------------------------------------------
+* The entry is followed by the length bytes of the line.
+*
+*  offset: nanoseconds since the start of the recording when the line was 
+*          executed.
+*  duration: nanoseconds that the line needed.
+*  status: exit status of the line.
+*  length: number of bytes of the line.
+*/
+struct record_entry
+{
+    long long offset;
+    long long duration;
+    int status;
+    uint32_t length;
+};
+
+/*
+* Structure for an entry of a profile:
+* ------------------------------------
+*  kind: PROFILE_LINE (a line of a script), PROFILE_BUILTIN (an internal
+*        command) or PROFILE_STACK (lines one inside the other, for the 
+*        flame graphs).
+*  key: "script:line", name of the internal command or the lines of the 
+*        stack separated by ';'.
+*  text: command of the line, NULL for the other kinds.
+*  count: number of executions.
+*  wall: nanoseconds of execution, the stacks without the nested lines.
+*  cpu: nanoseconds of CPU of the sons waited during the execution.
+*  sons: number of sons created.
+*  next: next entry of the same position of the hash table.
+*/
+struct profile_entry
+{
+    int kind;
+    char *key;
+    char *text;
+    unsigned long count;
+    long long wall;
+    long long cpu;
+    unsigned long sons;
+    struct profile_entry *next;
+};
+
+/*
+* Structure for a line in execution of a profiled script:
+* -------------------------------------------------------
+*  entry: entry of the line.
+*  start, cpu, sons: monotonic time, CPU of the sons and sons created when 
+*        the line started.
+*  nested: nanoseconds of the lines executed inside this one, by source or
+*        by a function.
+*/
+struct profile_frame
+{
+    struct profile_entry *entry;
+    long long start;
+    long long cpu;
+    unsigned long sons;
+    long long nested;
+};
+
+/*
+* Structure for the profile of source --profile:
+* ----------------------------------------------
+*  table: hash table with the entries.
+*  frames, n_frames: lines in execution, each one inside the previous one.
+*  path: script in execution.
+*  output: file for the collapsed stacks, NULL to print the report.
+*  start, cpu, sons: monotonic time, CPU of the sons and sons created when
+*        the profile started.
+*  n_lines: number of lines executed.
+*/
+struct profile
+{
+    struct profile_entry *table[PROFILE_SIZE];
+    struct profile_frame frames[PROFILE_DEPTH];
+    int n_frames;
+    const char *path;
+    const char *output;
+    long long start;
+    long long cpu;
+    unsigned long sons;
+    unsigned long n_lines;
+};
+
+/*
+* Structure for the options of cache:
+* -----------------------------------
+*  ttl: nanoseconds that an entry is valid, -1 if it does not expire.
+*  key_files, n_key_files: files whose modification time is in the key.
+*  env, n_env: environment variables added to the key.
+*  command: first token of the command to execute.
+*/
+struct cache_options
+{
+    long long ttl;
+    char *key_files[CACHE_KEY_FILES];
+    int n_key_files;
+    char *env[CACHE_ENV];
+    int n_env;
+    char **command;
+};
+
+/*
+* Structure for a node of a compiled script:
+* ------------------------------------------
+*  type: kind of node (NODE_COMMAND, NODE_IF...).
+*  line: line of the script where the node starts.
+*  words, n_words: tokens separated by '\0' and their number. They are the 
+*              command (NODE_COMMAND), the variable and the values (NODE_FOR),
+*              the word to compare (NODE_CASE) or the patterns (NODE_PATTERN).
+*  count: number of loops left by break and continue, status of return (-1
+*              to keep the last status).
+*  condition: condition of if, while and until, left side of && and ||.
+*  body: commands of if, loops and patterns, first command of a list or 
+*              first pattern of case, right side of && and ||.
+*  orelse: commands of else or the node of elif.
+*  next: next command of the list or next pattern of case.
+*  newline, blank: 1 if the command is the first one of its line and 1 if 
+*              there is an empty line before it.
+*  references: number of calls in execution of a function, its body is not
+*              freed until they finish.
+*/
+struct script_node
+{
+    int type;
+    int line;
+    struct capture words;
+    int n_words;
+    int count;
+    struct script_node *condition;
+    struct script_node *body;
+    struct script_node *orelse;
+    struct script_node *next;
+    int newline;
+    int blank;
+    int references;
+};
+
+/*
+* Structure for a command of the table of commands:
+* -------------------------------------------------
+* A name can be at the same time an alias, a function and an internal 
+* command, so a single lookup finds all of them.
+*
+*  name: name of the command, allocated with malloc.
+*  alias: text that replaces the name or NULL if it is not an alias.
+*  function: body of the function or NULL if it is not a function.
+*  builtin: internal command or NULL if it is not internal.
+*  next: next command of the same position of the hash table.
+*/
+struct command_entry
+{
+    char *name;
+    char *alias;
+    struct script_node *function;
+    int (*builtin)(char **args);
+    struct command_entry *next;
+};
+
+/*
+* Structure for the lexical analysis of a script:
+* -----------------------------------------------
+*  path: name of the script, used in the errors.
+*  pos: next character to analyze.
+*  line: line of pos.
+*  type: type of the current token (TOKEN_WORD...).
+*  token, length: text of the current token and its length.
+*  token_line: line of the current token.
+*  error: 1 if a syntax error has been found.
+*  blank: 1 if the current token is a new line that ends an empty line.
+*/
+struct script_lexer
+{
+    const char *path;
+    char *pos;
+    int line;
+    int type;
+    char *token;
+    int length;
+    int token_line;
+    int error;
+    int blank;
+};
+
+/*
+* Structure for a job of a batch:
+* -------------------------------
+*  pid: pid of the son, 0 if it has not been launched.
+*  position: position of the job in the jobs_list.
+*  output: memfds with the stdout and the stderr of the job, -1 when they 
+*          have been flushed.
+*  status: exit status of the job, -1 while it is running.
+*/
+struct batch_job
+{
+    pid_t pid;
+    int position;
+    int output[2];
+    int status;
+};
+
+/*
+* Structure for a batch of jobs executed in parallel:
+* ---------------------------------------------------
+* The output of each job is kept in its memfds and written when the jobs 
+* before it have been written, so it is shown in the order of the jobs.
+*
+*  jobs, n_jobs: jobs of the batch.
+*  slots: maximum number of jobs running at the same time.
+*  fail_fast: 1 to stop the batch when a job does not end with status 0.
+*  failed: job that stopped the batch, -1 if it has not been stopped.
+*  launch: function that launches a job with launch_job and the options.
+*  data: pointer used by launch and pump.
+*  pump: function called before waiting for the jobs, or NULL.
+*/
+struct batch
+{
+    struct batch_job *jobs;
+    int n_jobs;
+    int slots;
+    int fail_fast;
+    int failed;
+    pid_t (*launch)(struct batch *batch, int job,
+                    struct launch_options *options);
+    void *data;
+    int (*pump)(struct batch *batch);
+};
+
+/*
+* Structure for the options of parallel:
+* --------------------------------------
+*  command: tokens of the command, {} is replaced by the input.
+*  replace: 1 if a token has {}, otherwise the input is the last argument.
+*  inputs, n_inputs: inputs of the jobs, one for each job.
+*  internal: 1 if the command is executed by a subshell (internal commands,
+*            functions and aliases).
+*/
+struct parallel_options
+{
+    char **command;
+    int replace;
+    char **inputs;
+    int n_inputs;
+    int internal;
+};
+
+/*
+* Structure for a chunk of the file of mapchunks:
+* -----------------------------------------------
+*  data: next byte to send, in the mapping of the file.
+*  length: number of bytes left to send.
+*  fd: write end of the pipe that is the stdin of the job, -1 when it has 
+*      been closed.
+*/
+struct map_chunk
+{
+    char *data;
+    size_t length;
+    int fd;
+};
+
+/*
+* Structure for the options of mapchunks:
+* ---------------------------------------
+*  chunks, n_chunks: chunks of the file, one for each job.
+*  command: tokens of the command.
+*  script: command executed by a subshell if it is not external, or NULL.
+*/
+struct map_options
+{
+    struct map_chunk *chunks;
+    int n_chunks;
+    char **command;
+    struct script_node *script;
+};
+
+/*
+* Structure for a son prepared by the pool:
+* -----------------------------------------
+*  pid: pid of the son.
+*  fd: socket where the son waits for the plan of its command.
+*/
+struct pool_child
+{
+    pid_t pid;
+    int fd;
+};
+
+/*
+* Structure for the header of the plan sent to a son of the pool:
+* ---------------------------------------------------------------
+* The header is followed by length bytes: the working directory, the 
+* arguments and the environment, each one ended with '\0'.
+*
+*  length: number of bytes after the header.
+*  n_args: number of arguments.
+*  n_env: number of environment variables.
+*/
+struct pool_plan
+{
+    uint32_t length;
+    int n_args;
+    int n_env;
+};
+
+/*
+* Structure for the context of a minishell:
+* -----------------------------------------
+*  jobs_list: jobs in execution, the position 0 is the foreground job. The 
+*              jobs do not move, so their position does not change.
+*  jobs_size, jobs_used: positions allocated in jobs_list and positions that
+*              have been used (the free ones have pid 0).
+*  n_jobs: number of background and stopped jobs in jobs_list.
+*  free_jobs, n_free: stack with the free positions below jobs_used.
+*  next_job_id: id of the next job, it is reset when there are no jobs.
+*  minishell: information of the minishell.
+*  foreground: default foreground (no active job).
+*  trace_ring: trace ring buffer, shared with the sons so they can log 
+*              before exec.
+*  event_fd, wake_pipe, timer_fd, watched_fd: event loop, the epoll instance,
+*              the pipe to wake it from signals, the timerfd of the timeouts
+*              and the descriptor watched for input.
+*  pin_policy, pin_next, n_pin_cpus, pin_cpus, pin_nodes: automatic pin 
+*              policy and CPU topology, the CPUs are ordered alternating the 
+*              NUMA nodes so consecutive jobs use other nodes.
+*  listen_fd, n_watching, clients: control socket and its clients.
+*  queue, n_queue, queue_size, queue_seq, queue_policy, queue_slots: heap of
+*              jobs waiting for a free slot, policy and number of slots.
+*  timers, n_timers, timers_size: heap of pending timeouts.
+*  timed_out: last job that has received the signal of its timeout.
+*  interrupt_hook: function called when Ctrl+C or Ctrl+Z are pressed without
+*              a foreground job, used to print the prompt again.
+*  interrupted: set to 1 when Ctrl+C is pressed without a foreground job.
+*  pending_newline, pending_prompt: set by ctrlc and ctrlz, the line break 
+*              and the interrupt_hook are done by interrupt_drain out of the
+*              signal handler.
+*  finished, n_finished: last background jobs finished, used by wait, and 
+*              number of jobs finished since the start (position n_finished
+*              % N_FINISHED is the next one).
+*  reaped: jobs reaped by the reaper that reap_drain has not processed yet.
+*  notify, n_notify, n_notify_failed, n_notify_signaled: finished jobs not
+*              notified yet, only the first NOTIFY_DETAIL are stored, the 
+*              number of them, the number that exited with a status other 
+*              than 0 and the number ended by a signal.
+*  notify_start: position in finished of the first job finished after the 
+*              last notification, the jobs that wait returns are removed from
+*              the notifications.
+*  last_status, last_bg_pid: exit status of the last command ($?) and pid of
+*              the last background job ($!).
+*  foreground_status: status returned by waitpid for the foreground job.
+*  statuses, n_statuses: exit status of each command executed in the last 
+*              command list ($PIPESTATUS).
+*  source_depth, loop_depth: number of nested scripts and loops in execution.
+*  loop_jump, loop_continue: loops left by the last break or continue and 1 
+*              if the last one continues with the next iteration.
+*  commands: hash table with the internal commands, functions and aliases.
+*  positional, n_positional: arguments of the function in execution ($0, 
+*              $1...) and their number, NULL out of a function.
+*  function_depth, returning: number of nested function calls and 1 after 
+*              return until the function finishes.
+*  keep_fds, n_keep_fds: descriptors above stderr that the sons receive 
+*              when they execute a command, the others are closed.
+*  exec_last: 1 if the last command of the main script (-c or a script 
+*              file) can replace the minishell.
+*  exec_script: script whose last command can replace the minishell, NULL
+*              if there is none.
+*  exec_next: 1 if the command executed by execute_args is the last one of
+*              exec_script.
+*  pool, n_pool, pool_size: sons forked in advance that wait for a command,
+*              their number and the number that is kept, 0 if it is off.
+*  pool_hits, pool_misses: launches that used a son of the pool and 
+*              launches that had to fork because the pool was empty.
+*  record_fd, record_start, n_recorded: file where the lines are recorded,
+*              -1 if they are not recorded, monotonic time when the 
+*              recording started and number of lines recorded.
+*  profile: profile of source --profile, NULL if no script is profiled.
+*  n_sons: number of sons created to execute commands, used by the profile.
+*/
+struct ms_context
+{
+    struct info_process *jobs_list;
+    int jobs_size;
+    int jobs_used;
+    int n_jobs;
+    int *free_jobs;
+    int n_free;
+    int next_job_id;
+    struct info_process minishell;
+    struct info_process foreground;
+    struct trace_ring *trace_ring;
+    int event_fd;
+    int wake_pipe[2];
+    int timer_fd;
+    int watched_fd;
+    int pin_policy;
+    int pin_next;
+    int n_pin_cpus;
+    int pin_cpus[CPU_SETSIZE];
+    int pin_nodes[CPU_SETSIZE];
+    int listen_fd;
+    int n_watching;
+    struct control_client clients[N_CLIENTS];
+    struct queue_entry *queue;
+    int n_queue;
+    int queue_size;
+    unsigned long queue_seq;
+    int queue_policy;
+    int queue_slots;
+    struct timer_entry *timers;
+    int n_timers;
+    int timers_size;
+    pid_t timed_out;
+    void (*interrupt_hook)(void);
+    volatile sig_atomic_t interrupted;
+    volatile sig_atomic_t pending_newline;
+    volatile sig_atomic_t pending_prompt;
+    struct finished_job finished[N_FINISHED];
+    unsigned long n_finished;
+    struct reap_queue reaped;
+    struct job_event notify[NOTIFY_DETAIL];
+    int n_notify;
+    int n_notify_failed;
+    int n_notify_signaled;
+    unsigned long notify_start;
+    int last_status;
+    pid_t last_bg_pid;
+    volatile int foreground_status;
+    int statuses[ARGS_SIZE];
+    int n_statuses;
+    int source_depth;
+    int loop_depth;
+    int loop_jump;
+    int loop_continue;
+    struct command_entry *commands[COMMANDS_SIZE];
+    char **positional;
+    int n_positional;
+    int function_depth;
+    int returning;
+    int keep_fds[KEEP_FDS];
+    int n_keep_fds;
+    int exec_last;
+    struct script_node *exec_script;
+    int exec_next;
+    struct pool_child pool[POOL_SIZE];
+    int n_pool;
+    int pool_size;
+    unsigned long pool_hits;
+    unsigned long pool_misses;
+    int record_fd;
+    long long record_start;
+    unsigned long n_recorded;
+    struct profile *profile;
+    unsigned long n_sons;
+};
+
+// Context that receives the signals and is used by the internal functions.
+extern struct ms_context *ms;
+
+// Function headers of the executor (ms_exec.c):
+int execute_line(char *line);
+int execute_command(char *line);
+int execute_args(char **tokens);
+pid_t launch_job(char **args, char *command, int bkg,
+                 struct launch_options *options);
+pid_t launch_prefixed(char **args, char **cmd, struct launch_options *options,
+                      int *bkg);
+int apply_launch_options(struct launch_options *options);
+void close_inherited_fds();
+void keep_fd_add(int fd);
+void keep_fd_remove(int fd);
+int exec_command(char **args);
+int exec_allowed();
+void close_exec_fds(int except);
+void subshell_init();
+int wait_foreground(char *command);
+int check_internal(char **args);
+int is_internal(const char *name);
+void reaper(int signum);
+void ctrlc(int signum);
+void ctrlz(int signum);
+void interrupt_drain();
+
+// Function headers of the parser (ms_parser.c):
+int parse_args(char **args, char *line);
+char *split_list(char *line, int *op);
+char *join_args(char **args, char *command);
+int is_background(char **args);
+int is_output_redirection(char **args);
+long long parse_duration(char *text);
+int signal_number(char *name);
+
+// Function headers of the internal commands (ms_builtins.c):
+int internal_cd(char **args);
+int aux_internal_cd(char *path, char c);
+int internal_export(char **args);
+int internal_source(char **args);
+int source_file(char *path, int slots);
+int source_text(const char *path, char *text, int slots);
+int internal_timeout(char **args);
+int internal_ulimit(char **args);
+int internal_exit(char **args);
+int internal_exec(char **args);
+int exec_redirection(char **args);
+
+// Function headers of the jobs and the queue (ms_jobs.c):
+int internal_jobs(char **args);
+int internal_fg(char **args);
+int internal_bg(char **args);
+int internal_submit(char **args);
+int internal_wait(char **args);
+int internal_kill(char **args);
+int job_spec(char *spec, int pids);
+void jobs_current(int *current, int *previous);
+int jobs_running();
+long finished_find(pid_t pid);
+long finished_next();
+int finished_wait(unsigned long position);
+int exit_status(int status);
+int reap_drain();
+int jobs_notify();
+int jobs_list_add(pid_t pid, char status, char *command_line, int id);
+int jobs_list_grow();
+int jobs_list_find(pid_t pid);
+int jobs_list_remove(int pos);
+int jobs_list_compare(const void *a, const void *b);
+int queue_before(struct queue_entry *a, struct queue_entry *b);
+int queue_compare(const void *a, const void *b);
+int queue_push(struct queue_entry *entry);
+char **queue_args(char **args);
+int queue_pop(struct queue_entry *entry);
+int queue_pump();
+int queue_drain();
+
+// Function headers of the CPU affinity (ms_affinity.c):
+int internal_pin(char **args);
+int parse_cpu_list(char *text, cpu_set_t *cpus);
+int pin_topology_load();
+int pin_choose_cpu();
+int pin_process(pid_t pid, cpu_set_t *cpus);
+
+// Function headers of the event loop and the timeouts (ms_events.c):
+long long monotonic_ns();
+int event_init();
+int event_high_fd(int fd);
+void event_wake();
+int event_wait(int fd);
+int timer_add(pid_t pid, long long deadline, int signal, long long kill_after);
+int timers_arm();
+void timers_remove(int pos);
+void timer_cancel(pid_t pid);
+int timers_down(int pos, struct timer_entry entry);
+int timers_expire();
+
+// Function headers of the control socket (ms_control.c):
+int control_listen(char *path);
+int control_accept();
+int control_find(int fd);
+int control_read(int fd);
+int control_execute(int client, char *line);
+int control_broadcast(struct job_event *event);
+
+// Function headers of the command substitution (ms_expand.c):
+char **expand_args(char **args, struct capture *fields);
+int expand_word(char *word, struct capture *output);
+int expand_parameter(char *text, struct capture *output);
+int command_substitution(char *command, struct capture *output);
+int capture_command(char *command, struct capture *output);
+int capture_internal(char **args, struct capture *output);
+int capture_son(char **args, char *line, struct capture *output);
+int capture_read(int fd, struct capture *output);
+int capture_append(struct capture *output, const char *data, size_t length);
+int capture_grow(struct capture *output, size_t size);
+
+// Function headers of the scripts (ms_script.c):
+struct script_node *script_compile(const char *path, char *text);
+struct script_node *script_list(struct script_lexer *lexer);
+struct script_node *script_and_or(struct script_lexer *lexer);
+struct script_node *script_command(struct script_lexer *lexer);
+struct script_node *script_simple(struct script_lexer *lexer);
+struct script_node *script_if(struct script_lexer *lexer);
+struct script_node *script_loop(struct script_lexer *lexer);
+struct script_node *script_for(struct script_lexer *lexer);
+struct script_node *script_case(struct script_lexer *lexer);
+struct script_node *script_group(struct script_lexer *lexer);
+struct script_node *script_jump(struct script_lexer *lexer);
+struct script_node *script_function(struct script_lexer *lexer,
+                                    struct script_node *node);
+int script_valid_name(char *name, int length);
+int script_needed(char *line);
+int script_line(char *line);
+int script_stopped();
+int script_tail(struct script_node *node, struct script_node *command);
+struct script_node *script_copy(struct script_node *node);
+int script_next(struct script_lexer *lexer);
+int script_is_word(struct script_lexer *lexer, const char *word);
+int script_list_end(struct script_lexer *lexer);
+int script_expect(struct script_lexer *lexer, const char *word);
+void script_error(struct script_lexer *lexer, const char *expected);
+struct script_node *script_node(struct script_lexer *lexer, int type);
+struct script_node *script_check(struct script_lexer *lexer,
+                                 struct script_node *node);
+int script_add_word(struct script_lexer *lexer, struct script_node *node);
+void script_free(struct script_node *node);
+int script_run(struct script_node *list, int notify);
+int script_chain(struct script_node *node, int *statuses, int *n_statuses);
+int script_execute(struct script_node *node);
+int script_simple_run(struct script_node *node);
+int script_loop_run(struct script_node *node);
+int script_for_run(struct script_node *node);
+int script_case_run(struct script_node *node);
+int script_jump_run(struct script_node *node);
+int script_return_run(struct script_node *node);
+int script_loop_next();
+char *script_words(struct script_node *node, char **tokens);
+
+// Function headers of the table of commands (ms_commands.c):
+int commands_init();
+void commands_free(struct command_entry **commands);
+unsigned int command_hash(const char *name);
+struct command_entry *command_find(const char *name);
+struct command_entry *command_add(const char *name);
+char **alias_expand(char **tokens, char **aliased, char **text);
+int function_define(char *name, struct script_node *body);
+int function_call(struct command_entry *entry, char **args);
+int internal_alias(char **args);
+int internal_unalias(char **args);
+int alias_compare(const void *a, const void *b);
+
+// Function headers of the cache of outputs (ms_cache.c):
+int internal_cache(char **args);
+int cache_options(char **args, struct cache_options *options);
+int cache_key(struct cache_options *options, struct capture *key);
+int cache_path(struct capture *key, char *path);
+int cache_replay(char *path, struct capture *key, long long ttl);
+int cache_store(char *path, struct capture *key, struct capture *output,
+                int status);
+int cache_send(int out, int fd, off_t offset, uint64_t length,
+               uint64_t *sent);
+
+// Function headers of the batches of jobs (ms_batch.c):
+int batch_run(struct batch *batch);
+int batch_launch(struct batch *batch, int job);
+int batch_collect(struct batch *batch, int first, int next);
+void batch_stop(struct batch *batch, int first, int next);
+int batch_flush(struct batch_job *job);
+int batch_source(struct script_node *script, int slots);
+int batch_serial(struct script_node *node);
+struct script_node *batch_next(struct script_node *node);
+pid_t batch_source_launch(struct batch *batch, int job,
+                          struct launch_options *options);
+int internal_parallel(char **args);
+int parallel_inputs(char *path, struct capture *text,
+                    struct parallel_options *parallel);
+int parallel_args(struct parallel_options *parallel, char *input,
+                  struct capture *words);
+pid_t parallel_launch(struct batch *batch, int job,
+                      struct launch_options *options);
+int internal_mapchunks(char **args);
+int mapchunks_split(char *data, size_t size, struct map_options *map);
+pid_t mapchunks_launch(struct batch *batch, int job,
+                       struct launch_options *options);
+int mapchunks_feed(struct batch *batch);
+void mapchunks_close(struct map_chunk *chunk);
+
+// Function headers of the pool of sons (ms_pool.c):
+int internal_pool(char **args);
+int pool_fill();
+void pool_park(int fd);
+int pool_read(int fd, void *buffer, size_t length);
+int pool_receive(int fd, struct pool_plan *header, int *stdio);
+int pool_send(int fd, struct capture *plan);
+pid_t pool_launch(char **args);
+int pool_plan(struct capture *plan, char **args);
+void pool_flush();
+
+// Function headers of the recorder of sessions (ms_record.c):
+int internal_record(char **args);
+int record_line(const char *line, long long start, long long duration,
+                int status);
+int internal_replay(char **args);
+int replay_wait(long long deadline);
+
+// Function headers of the profiler of scripts (ms_profile.c):
+int profile_source(char *path, const char *output);
+int profile_begin(struct script_node *node, char **tokens);
+void profile_end();
+int profile_builtin(struct command_entry *entry, char **args);
+struct profile_entry *profile_find(int kind, const char *key);
+long long profile_cpu();
+void profile_finish();
+void profile_print(int kind, const char *title, long long total);
+int profile_write(const char *path);
+int profile_compare(const void *a, const void *b);
+
+// Function headers of the trace (ms_trace.c):
+int internal_trace(char **args);
+void trace_event(char phase, const char *name, const char *detail, long arg);
+int trace_dump(char *path);
+
+#endif
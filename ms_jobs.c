@@ -0,0 +1,1142 @@
+/*
+* Job table of libminishell: the jobs list, the internal commands jobs, fg,
+* bg, wait and the queue of jobs of submit.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#include "ms_internal.h"
+
+/*
+* Function: internal_jobs:
+* ------------------------
+* Prints all active jobs in background with their id, pid, state, and command
+* line, ordered by id.
+*  
+*  args: pointer array that storages all the tokens in a command line.
+*  
+*  returns: exit success.
+*/
+int internal_jobs(char **args)
+{
+    // Sorts the positions of the jobs by their id.
+    if (ms->n_jobs)
+    {
+        int *sorted_jobs = malloc(sizeof(int) * ms->n_jobs);
+        if (!sorted_jobs)
+        {
+            return EXIT_FAILURE;
+        }
+        int n = 0;
+        for (int job = 1; job < ms->jobs_used; job++)
+        {
+            if (ms->jobs_list[job].pid)
+            {
+                sorted_jobs[n++] = job;
+            }
+        }
+        qsort(sorted_jobs, n, sizeof(int), jobs_list_compare);
+
+        // Prints each job, + is the current job and - the previous one.
+        int current, previous;
+        jobs_current(&current, &previous);
+        for (int i = 0; i < n; i++)
+        {
+            int job = sorted_jobs[i];
+            printf("[%d]%c %d\t%c\t%s\n", ms->jobs_list[job].id,
+                   job == current ? '+' : job == previous ? '-' : ' ',
+                   ms->jobs_list[job].pid, ms->jobs_list[job].status,
+                   ms->jobs_list[job].command_line);
+        }
+        free(sorted_jobs);
+    }
+    // Prints the queued jobs in the order they will be executed.
+    if (ms->n_queue)
+    {
+        struct queue_entry *sorted = malloc(sizeof(struct queue_entry) * 
+                                            ms->n_queue);
+        if (!sorted)
+        {
+            return EXIT_FAILURE;
+        }
+        memcpy(sorted, ms->queue, sizeof(struct queue_entry) * ms->n_queue);
+        qsort(sorted, ms->n_queue, sizeof(struct queue_entry), queue_compare);
+        for (int i = 0; i < ms->n_queue; i++)
+        {
+            printf("[Q%d] p=%d\t%c\t%s\n", i + 1, sorted[i].priority, QUEUED,
+                   sorted[i].command_line);
+        }
+        free(sorted);
+        printf("En cola: %d, huecos: %d\n", ms->n_queue, ms->queue_slots);
+    }
+    return EXIT_SUCCESS;
+}
+/*
+* Function: internal_fg:
+* ----------------------
+* The indicated job is brought to foreground sending its signal to continue.
+* Without arguments the current job (%+) is used. SIGCHLD is blocked while 
+* the job becomes the foreground job and the jobs already reaped are removed
+* before, so a job that ends meanwhile is not waited for forever.
+* 
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: the exit status of the job or exit failure if the job does not 
+*           exist or the introduced command is not correct.
+*/
+int internal_fg(char **args)
+{
+    // If the command was correctly introduced.
+    if (!args[1] || !args[2])
+    {
+        sigset_t mask, old_mask;
+        sigemptyset(&mask);
+        sigaddset(&mask, SIGCHLD);
+        sigprocmask(SIG_BLOCK, &mask, &old_mask);
+        reap_drain();
+
+        // Gets the position for the job and checks if it is valid.
+        int job = job_spec(args[1] ? args[1] : "%+", 0);
+        if (job > 0)
+        {
+            // If the job is in stopped state, sends continue signal to it.
+            if (ms->jobs_list[job].status == STOPPED)
+            {
+                kill(ms->jobs_list[job].pid, SIGCONT);
+            }
+            // Updates foreground with the job information.
+            ms->jobs_list[FOREGROUND].pid = ms->jobs_list[job].pid;
+            ms->jobs_list[FOREGROUND].id = ms->jobs_list[job].id;
+            ms->jobs_list[FOREGROUND].status = EXECUTED;
+            strcpy(ms->jobs_list[FOREGROUND].command_line,
+                   ms->jobs_list[job].command_line);
+
+            // Removes the job from its previous position in jobs_list.
+            jobs_list_remove(job);
+
+            // If his command line contains the char '&' it is removed.
+            char *pos = strchr(ms->jobs_list[FOREGROUND].command_line, '&');
+            if (pos)
+            {
+                *(pos - 1) = '\0';
+            }
+            sigprocmask(SIG_SETMASK, &old_mask, NULL);
+
+            // Prints the command line.
+            printf("%s\n", ms->jobs_list[FOREGROUND].command_line);
+
+            // Waits for the job to finish.
+            return wait_foreground(ms->jobs_list[FOREGROUND].command_line);
+        }
+        sigprocmask(SIG_SETMASK, &old_mask, NULL);
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "La sintaxis es erronea, fg [trabajo]\n");
+    return EXIT_FAILURE;
+}
+/*
+* Function: internal_bg:
+* ----------------------
+* The job indicated by parameter is resumed in background by sending continue
+* signal if it was stopped. Without arguments the current job (%+) is used.
+* 
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: exit success or exit failure if the job is already in background,
+*           the job does not exist or the command was not correctly introduced.
+*/
+int internal_bg(char **args)
+{
+    // Checks if the command was introduced correctly.
+    if (!args[1] || !args[2])
+    {
+        // Gets the position for the job and checks if it is valid.
+        int job = job_spec(args[1] ? args[1] : "%+", 0);
+        if (job > 0)
+        {
+            // Checks if the job is stopped.
+            if (ms->jobs_list[job].status == STOPPED)
+            {
+                // Adds " &\0" to the command line and updates the job.
+                strcat(ms->jobs_list[job].command_line, " &\0");
+                ms->jobs_list[job].status = EXECUTED;
+
+                // Sends the signal to continue the job.
+                kill(ms->jobs_list[job].pid, SIGCONT);
+                return EXIT_SUCCESS;
+            }
+            fprintf(stderr, "El trabajo %d ya está en 2º plano.\n",
+                    ms->jobs_list[job].id);
+            return EXIT_FAILURE;
+        }
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "La sintaxis es errónea, bg [trabajo].\n");
+    return EXIT_FAILURE;
+}
+
+/*
+* Function: internal_kill:
+* ------------------------
+* Sends a signal (SIGTERM by default) to jobs or processes. The syntax is:
+* kill [-s SIG | -SIG] trabajo|PID..., where trabajo is a job specification
+* (%n, %+, %-, %prefix or %?text).
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: exit success or exit failure if a signal could not be sent.
+*/
+int internal_kill(char **args)
+{
+    int sig = SIGTERM;
+    int i = 1;
+
+    // Reads the signal.
+    if (args[i] && !strcmp(args[i], "-s") && args[i + 1])
+    {
+        sig = signal_number(args[i + 1]);
+        i += 2;
+    }
+    else if (args[i] && args[i][0] == '-')
+    {
+        sig = signal_number(args[i] + 1);
+        i++;
+    }
+    if (sig < 0 || !args[i])
+    {
+        fprintf(stderr, "La sintaxis es errónea, kill [-s señal | -señal] "
+                        "trabajo|PID...\n");
+        return EXIT_FAILURE;
+    }
+    int result = EXIT_SUCCESS;
+    for (; args[i]; i++)
+    {
+        // Gets the pid, the numbers that are not jobs are sent directly.
+        int job = job_spec(args[i], 1);
+        pid_t pid = job > 0 ? ms->jobs_list[job].pid : 0;
+        if (job < 0 && args[i][0] != '%')
+        {
+            pid = atoi(args[i]);
+        }
+        if (pid <= 0)
+        {
+            result = EXIT_FAILURE;
+            continue;
+        }
+        if (kill(pid, sig))
+        {
+            perror("kill");
+            result = EXIT_FAILURE;
+        }
+        // Updates the status of the job when it is stopped or continued.
+        else if (job > 0 && (sig == SIGSTOP || sig == SIGTSTP))
+        {
+            ms->jobs_list[job].status = STOPPED;
+        }
+        else if (job > 0 && sig == SIGCONT)
+        {
+            ms->jobs_list[job].status = EXECUTED;
+        }
+    }
+    return result;
+}
+
+/*
+* Function: job_spec:
+* -------------------
+* Looks for the job of a job specification: %n (id), %+ or %% (current job),
+* %- (previous job), %prefix (command line that starts with prefix) and 
+* %?text (command line that contains text). A number without % is an id or, 
+* if pids is 1, a pid.
+*
+*  spec: job specification.
+*  pids: 1 if the numbers without % are pids.
+*
+*  returns: the position of the job in jobs_list or -1 if it does not exist 
+*           or it is ambiguous.
+*/
+int job_spec(char *spec, int pids)
+{
+    int found = -1;
+    char *text = spec[0] == '%' ? spec + 1 : spec;
+
+    // Numbers: ids or pids.
+    char *end;
+    long number = strtol(text, &end, 10);
+    if (*text && !*end)
+    {
+        for (int job = 1; job < ms->jobs_used && found < 0; job++)
+        {
+            if (ms->jobs_list[job].pid && (pids && spec[0] != '%' ?
+                ms->jobs_list[job].pid == number :
+                ms->jobs_list[job].id == number))
+            {
+                found = job;
+            }
+        }
+    }
+    // Current and previous job.
+    else if (spec[0] == '%' && (!*text || !strcmp(text, "+") ||
+                                !strcmp(text, "%") || !strcmp(text, "-")))
+    {
+        int current, previous;
+        jobs_current(&current, &previous);
+        found = strcmp(text, "-") ? current : previous;
+    }
+    // Command lines that start with or contain a text.
+    else if (spec[0] == '%')
+    {
+        int contains = text[0] == '?';
+        text += contains;
+        for (int job = 1; job < ms->jobs_used; job++)
+        {
+            char *command_line = ms->jobs_list[job].command_line;
+            if (ms->jobs_list[job].pid && (contains ?
+                strstr(command_line, text) != NULL :
+                !strncmp(command_line, text, strlen(text))))
+            {
+                if (found > 0)
+                {
+                    fprintf(stderr, "El trabajo %s es ambiguo.\n", spec);
+                    return -1;
+                }
+                found = job;
+            }
+        }
+    }
+    if (found < 0 && (spec[0] == '%' || !pids))
+    {
+        fprintf(stderr, "El trabajo %s no existe.\n", spec);
+    }
+    return found;
+}
+/*
+* Function: internal_submit:
+* --------------------------
+* Adds a command to the queue of jobs. The queued jobs are executed in 
+* background when there is a free slot, that is, when there are less running
+* background jobs than slots. "submit [-p prioridad] orden" queues a command,
+* "submit -j N" changes the number of slots and "submit -P fifo|prio" changes
+* the policy. Without arguments it shows the state of the queue.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: exit success or exit failure if the command was not correct.
+*/
+int internal_submit(char **args)
+{
+    struct queue_entry entry;
+    entry.priority = 0;
+
+    // The default number of slots is the number of CPUs.
+    if (!ms->queue_slots)
+    {
+        ms->queue_slots = sysconf(_SC_NPROCESSORS_ONLN);
+        if (ms->queue_slots < 1)
+        {
+            ms->queue_slots = 1;
+        }
+    }
+    // Shows the state of the queue.
+    if (!args[1])
+    {
+        printf("Política: %s, huecos: %d, en cola: %d\n",
+               ms->queue_policy == QUEUE_FIFO ? "fifo" : "prio",
+               ms->queue_slots, ms->n_queue);
+        return EXIT_SUCCESS;
+    }
+    // Changes the number of slots.
+    if (!strcmp(args[1], "-j") && args[2] && !args[3])
+    {
+        int slots = atoi(args[2]);
+        if (slots < 1)
+        {
+            fprintf(stderr, "El número de huecos debe ser mayor que 0.\n");
+            return EXIT_FAILURE;
+        }
+        ms->queue_slots = slots;
+        queue_pump();
+        return EXIT_SUCCESS;
+    }
+    // Changes the policy and reorders the queue.
+    if (!strcmp(args[1], "-P") && args[2] && !args[3])
+    {
+        if (strcmp(args[2], "fifo") && strcmp(args[2], "prio"))
+        {
+            fprintf(stderr, "Política no válida: %s\n", args[2]);
+            return EXIT_FAILURE;
+        }
+        ms->queue_policy = strcmp(args[2], "fifo") ? QUEUE_PRIORITY :
+                           QUEUE_FIFO;
+        qsort(ms->queue, ms->n_queue, sizeof(struct queue_entry),
+              queue_compare);
+        return EXIT_SUCCESS;
+    }
+    // Reads the priority.
+    int i = 1;
+    if (!strcmp(args[1], "-p") && args[2])
+    {
+        char *end;
+        entry.priority = strtol(args[2], &end, 10);
+        if (*end)
+        {
+            fprintf(stderr, "Prioridad no válida: %s\n", args[2]);
+            return EXIT_FAILURE;
+        }
+        i = 3;
+    }
+    if (!args[i])
+    {
+        fprintf(stderr, "La sintaxis es errónea, submit [-p prioridad] orden"
+                        " | submit -j N | submit -P fifo|prio\n");
+        return EXIT_FAILURE;
+    }
+    // Queues the arguments, already expanded, as a background job.
+    entry.command_line = malloc(sizeof(char) * COMMAND_LINE_SIZE);
+    entry.args = queue_args(&args[i]);
+    if (!entry.command_line || !entry.args)
+    {
+        free(entry.command_line);
+        free(entry.args);
+        return EXIT_FAILURE;
+    }
+    join_args(entry.args, entry.command_line);
+    entry.seq = ms->queue_seq++;
+    if (queue_push(&entry))
+    {
+        free(entry.command_line);
+        free(entry.args);
+        return EXIT_FAILURE;
+    }
+    queue_pump();
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: jobs_current:
+* -----------------------
+* Looks for the current job (%+) and the previous job (%-). The current job 
+* is the last stopped job or, if there is none, the last job.
+*
+*  current: pointer where the position of the current job is stored.
+*  previous: pointer where the position of the previous job is stored.
+*
+*  returns: void, the positions are -1 if there is no job.
+*/
+void jobs_current(int *current, int *previous)
+{
+    *current = -1;
+    *previous = -1;
+    for (int job = 1; job < ms->jobs_used; job++)
+    {
+        if (!ms->jobs_list[job].pid)
+        {
+            continue;
+        }
+        if (*current < 0 || jobs_list_compare(&job, current) > 0)
+        {
+            *previous = *current;
+            *current = job;
+        }
+        else if (*previous < 0 || jobs_list_compare(&job, previous) > 0)
+        {
+            *previous = job;
+        }
+    }
+}
+
+/*
+* Function: internal_wait:
+* ------------------------
+* Waits in the event loop for background jobs. "wait" waits until all the 
+* running and queued jobs have finished, "wait %n" and "wait PID" wait for a 
+* job and "wait -n" waits until any job finishes. Ctrl+C stops the wait.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: the exit status of the job, 0 for "wait" or 127 if the job does 
+*           not exist.
+*/
+int internal_wait(char **args)
+{
+    ms->interrupted = 0;
+
+    // Waits for all the jobs, the stopped ones are not waited.
+    if (!args[1])
+    {
+        while ((jobs_running() || ms->n_queue) && !ms->interrupted)
+        {
+            event_wait(-1);
+        }
+        return ms->interrupted ? 130 : 0;
+    }
+    if (args[2])
+    {
+        fprintf(stderr, "La sintaxis es errónea, wait [-n | %%n | PID]\n");
+        return EXIT_FAILURE;
+    }
+    // Returns a job that finished before the wait or waits until one 
+    // finishes.
+    if (!strcmp(args[1], "-n"))
+    {
+        reap_drain();
+        long position = finished_next();
+        while (position < 0 && (jobs_running() || ms->n_queue) &&
+               !ms->interrupted)
+        {
+            event_wait(-1);
+            position = finished_next();
+        }
+        if (position >= 0)
+        {
+            return finished_wait(position);
+        }
+        return ms->interrupted ? 130 : 127;
+    }
+    // Gets the pid of the job.
+    pid_t pid;
+    if (*args[1] == '%')
+    {
+        int job = job_spec(args[1], 1);
+        if (job < 0)
+        {
+            return 127;
+        }
+        pid = ms->jobs_list[job].pid;
+    }
+    else
+    {
+        pid = atoi(args[1]);
+    }
+    // Waits while the job is in the list.
+    if (jobs_list_find(pid) <= 0 && finished_find(pid) < 0)
+    {
+        fprintf(stderr, "El proceso %s no es un hijo del shell.\n", args[1]);
+        return 127;
+    }
+    while (jobs_list_find(pid) > 0 && !ms->interrupted)
+    {
+        event_wait(-1);
+    }
+    if (ms->interrupted)
+    {
+        return 130;
+    }
+    long position = finished_find(pid);
+    return position < 0 ? 127 : finished_wait(position);
+}
+
+/*
+* Function: jobs_running:
+* -----------------------
+* Counts the background jobs that are being executed.
+*
+*  returns: the number of running background jobs.
+*/
+int jobs_running()
+{
+    int running = 0;
+    for (int job = 1; job < ms->jobs_used; job++)
+    {
+        running += ms->jobs_list[job].pid &&
+                   ms->jobs_list[job].status == EXECUTED;
+    }
+    return running;
+}
+
+/*
+* Function: finished_find:
+* ------------------------
+* Looks for a job in the last finished jobs.
+*
+*  pid: pid of the job.
+*
+*  returns: the position of the job in finished or -1 if it is not found.
+*/
+long finished_find(pid_t pid)
+{
+    unsigned long first = ms->n_finished > N_FINISHED ? 
+                          ms->n_finished - N_FINISHED : 0;
+    for (unsigned long i = ms->n_finished; i > first; i--)
+    {
+        if (ms->finished[(i - 1) % N_FINISHED].pid == pid)
+        {
+            return i - 1;
+        }
+    }
+    return -1;
+}
+
+/*
+* Function: finished_next:
+* ------------------------
+* Looks for the first finished job that wait has not returned yet, even if 
+* it has been notified.
+*
+*  returns: the position of the job in finished or -1 if there is none.
+*/
+long finished_next()
+{
+    unsigned long first = ms->n_finished > N_FINISHED ? 
+                          ms->n_finished - N_FINISHED : 0;
+    for (unsigned long i = first; i < ms->n_finished; i++)
+    {
+        if (!ms->finished[i % N_FINISHED].waited)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+* Function: finished_wait:
+* ------------------------
+* Marks a finished job as returned by wait, if it has not been notified yet
+* it is removed from the notifications.
+*
+*  position: position of the job in finished.
+*
+*  returns: the exit status of the job.
+*/
+int finished_wait(unsigned long position)
+{
+    struct finished_job *job = &ms->finished[position % N_FINISHED];
+    if (!job->waited && position >= ms->notify_start)
+    {
+        ms->n_notify--;
+        ms->n_notify_failed -= WIFEXITED(job->status) &&
+                               WEXITSTATUS(job->status);
+        ms->n_notify_signaled -= WIFSIGNALED(job->status);
+    }
+    job->waited = 1;
+    return exit_status(job->status);
+}
+
+/*
+* Function: exit_status:
+* ----------------------
+* Converts the status returned by waitpid into an exit status, the jobs ended
+* by a signal return 128 plus the signal.
+*
+*  status: status returned by waitpid.
+*
+*  returns: the exit status.
+*/
+int exit_status(int status)
+{
+    if (WIFSIGNALED(status))
+    {
+        return 128 + WTERMSIG(status);
+    }
+    return WEXITSTATUS(status);
+}
+
+/*
+* Function: reap_drain:
+* ---------------------
+* Processes the jobs reaped by the reaper: saves their status for wait, sends
+* the event to the control socket, removes them from the jobs_list and keeps
+* them to be notified. The jobs of a batch are only marked as finalized. It
+* is called out of the signal handlers, in the event loop and before 
+* executing each line.
+*
+*  returns: the number of jobs processed.
+*/
+int reap_drain()
+{
+    int drained = 0;
+    while (1)
+    {
+        unsigned long head = __atomic_load_n(&ms->reaped.head,
+                                             __ATOMIC_ACQUIRE);
+        while (ms->reaped.tail != head)
+        {
+            struct finished_job job = ms->reaped.entries[ms->reaped.tail %
+                                                         REAP_QUEUE_SIZE];
+            __atomic_store_n(&ms->reaped.tail, ms->reaped.tail + 1,
+                             __ATOMIC_RELEASE);
+            drained++;
+            timer_cancel(job.pid);
+
+            // The jobs of a batch are kept until the batch collects them.
+            int position = jobs_list_find(job.pid);
+            if (position > 0 && ms->jobs_list[position].batch)
+            {
+                ms->jobs_list[position].status = FINALIZED;
+                ms->jobs_list[position].wait_status = job.status;
+                continue;
+            }
+            // Saves the status for wait.
+            job.waited = 0;
+            ms->finished[ms->n_finished % N_FINISHED] = job;
+            ms->n_finished++;
+
+            // Creates the event with the information of the job.
+            struct job_event event;
+            event.pid = job.pid;
+            event.status = job.status;
+            event.id = 0;
+            event.command_line[0] = '\0';
+            if (position > 0)
+            {
+                event.id = ms->jobs_list[position].id;
+                snprintf(event.command_line, EVENT_COMMAND_SIZE, "%.*s",
+                         EVENT_COMMAND_SIZE - 1,
+                         ms->jobs_list[position].command_line);
+                jobs_list_remove(position);
+            }
+            control_broadcast(&event);
+
+            // Keeps the job to be notified.
+            if (ms->n_notify < NOTIFY_DETAIL)
+            {
+                ms->notify[ms->n_notify] = event;
+            }
+            ms->n_notify++;
+            ms->n_notify_failed += WIFEXITED(job.status) &&
+                                   WEXITSTATUS(job.status);
+            ms->n_notify_signaled += WIFSIGNALED(job.status);
+        }
+        // Reaps the sons that did not fit in the queue.
+        if (!ms->reaped.overflow)
+        {
+            return drained;
+        }
+        ms->reaped.overflow = 0;
+        kill(getpid(), SIGCHLD);
+    }
+}
+
+/*
+* Function: jobs_notify:
+* ----------------------
+* Prints the finished jobs that have not been notified with their exit 
+* status or the signal that ended them, the jobs returned by wait are not 
+* notified. If more than NOTIFY_DETAIL jobs have finished only a summary is
+* printed.
+*
+*  returns: the number of jobs notified.
+*/
+int jobs_notify()
+{
+    int notified = ms->n_notify;
+    unsigned long finished = ms->n_finished - ms->notify_start;
+    if (finished > NOTIFY_DETAIL && notified)
+    {
+        printf("Terminados %d trabajos, %d con estado distinto de 0 y %d por "
+               "una señal\n", notified, ms->n_notify_failed,
+               ms->n_notify_signaled);
+    }
+    else if (finished <= NOTIFY_DETAIL)
+    {
+        // The events are stored in the same order as the finished jobs.
+        for (unsigned long i = 0; i < finished; i++)
+        {
+            if (ms->finished[(ms->notify_start + i) % N_FINISHED].waited)
+            {
+                continue;
+            }
+            struct job_event *event = &ms->notify[i];
+            printf("Terminado [%d] PID %d (%s) ", event->id, event->pid,
+                   event->command_line);
+            if (WIFSIGNALED(event->status))
+            {
+                const char *name = sigabbrev_np(WTERMSIG(event->status));
+                printf("por la señal %d (SIG%s)\n", WTERMSIG(event->status),
+                       name ? name : "?");
+            }
+            else
+            {
+                printf("con estado %d\n", WEXITSTATUS(event->status));
+            }
+        }
+    }
+    ms->n_notify = 0;
+    ms->n_notify_failed = 0;
+    ms->n_notify_signaled = 0;
+    ms->notify_start = ms->n_finished;
+    return notified;
+}
+
+/*
+* Function: jobs_list_add:
+* ------------------------
+* Adds a new job to a free position of the jobs_list, that grows if it is 
+* full. The job receives the next id unless it already had one.
+* 
+*  pid: the pid of the process to add.
+*  status: the status of the process to add.
+*  command_line: the command_line of the process to add.
+*  id: id of the job or 0 to give it a new id.
+* 
+*  returns: the position of the job or -1 if it was not able to add the job.
+*/
+int jobs_list_add(pid_t pid, char status, char *command_line, int id)
+{
+    // Uses a free position or the next one, the list grows if it is full.
+    int position;
+    if (ms->n_free)
+    {
+        position = ms->free_jobs[--ms->n_free];
+    }
+    else if (ms->jobs_used < ms->jobs_size || !jobs_list_grow())
+    {
+        position = ms->jobs_used++;
+    }
+    else
+    {
+        fprintf(stderr, "No se pueden añadir mas trabajos a la lista.\n");
+        return -1;
+    }
+    // Adds the new job.
+    ms->jobs_list[position].id = id ? id : ms->next_job_id++;
+    ms->jobs_list[position].status = status;
+    strcpy(ms->jobs_list[position].command_line, command_line);
+    ms->jobs_list[position].cpu = -1;
+    ms->jobs_list[position].batch = 0;
+    ms->jobs_list[position].pid = pid;
+    if (ms->jobs_list[position].id >= ms->next_job_id)
+    {
+        ms->next_job_id = ms->jobs_list[position].id + 1;
+    }
+    // Updates the number of jobs.
+    ms->n_jobs++;
+    return position;
+}
+
+/*
+* Function: jobs_list_grow:
+* -------------------------
+* Doubles the size of the jobs_list. The signals that use the foreground job
+* are blocked while the list moves.
+* 
+*  returns: exit success or exit failure if there is no memory.
+*/
+int jobs_list_grow()
+{
+    sigset_t mask, old_mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGTSTP);
+    sigprocmask(SIG_BLOCK, &mask, &old_mask);
+
+    int size = ms->jobs_size * 2;
+    int result = EXIT_FAILURE;
+    struct info_process *jobs = realloc(ms->jobs_list, 
+                                        sizeof(struct info_process) * size);
+    if (jobs)
+    {
+        ms->jobs_list = jobs;
+        int *free_jobs = realloc(ms->free_jobs, sizeof(int) * size);
+        if (free_jobs)
+        {
+            ms->free_jobs = free_jobs;
+            ms->jobs_size = size;
+            result = EXIT_SUCCESS;
+        }
+    }
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+    return result;
+}
+/*
+* Function: jobs_list_find:
+* -------------------------
+* Finds and returns the position of the job in the jobs_list.
+*
+*  pid: pid from the process to find.
+*
+*  returns: the position of the process, else -1.
+*/
+int jobs_list_find(pid_t pid)
+{
+    int position = 0;
+
+    // Search for the job with the same pid as the one introduced.
+    while (position < ms->jobs_used && pid != ms->jobs_list[position].pid)
+    {
+        position++;
+    }
+    // If it was not found then returns -1.
+    if (position == ms->jobs_used)
+    {
+        return -1;
+    }
+    return position;
+}
+/*
+* Function: jobs_list_remove:
+* ---------------------------
+* Removes a job from the list and adds his position to the free positions. 
+* The other jobs do not move. When there are no jobs the ids start again.
+*
+*  position: index of the job to be removed.
+*
+*  returns: exit success or exit failure if the index is not valid.
+*/
+int jobs_list_remove(int position)
+{
+    // Checks for a valid position.
+    if (0 < position && position < ms->jobs_used &&
+        ms->jobs_list[position].pid)
+    {
+        // Frees the position.
+        ms->jobs_list[position].pid = 0;
+        ms->jobs_list[position].command_line[0] = '\0';
+        ms->free_jobs[ms->n_free++] = position;
+
+        // Updates the number of jobs.
+        ms->n_jobs--;
+        if (!ms->n_jobs)
+        {
+            ms->jobs_used = 1;
+            ms->n_free = 0;
+            ms->next_job_id = 1;
+        }
+        return EXIT_SUCCESS;
+    }
+    else
+    {
+        fprintf(stderr, "La posición introducida es errónea.\n");
+        return EXIT_FAILURE;
+    }
+}
+
+/*
+* Function: jobs_list_compare:
+* ----------------------------
+* Compares two positions of the jobs_list for qsort. The stopped jobs go 
+* after the executed ones and, between them, the jobs are ordered by id, so 
+* the last one is the current job (%+).
+*
+*  a: pointer to the first position.
+*  b: pointer to the second position.
+*
+*  returns: negative if a goes before b, otherwise positive.
+*/
+int jobs_list_compare(const void *a, const void *b)
+{
+    struct info_process *x = &ms->jobs_list[*(const int *)a];
+    struct info_process *y = &ms->jobs_list[*(const int *)b];
+    if ((x->status == STOPPED) != (y->status == STOPPED))
+    {
+        return x->status == STOPPED ? 1 : -1;
+    }
+    return x->id - y->id;
+}
+/*
+* Function: queue_before:
+* -----------------------
+* Compares two queued jobs using the current policy.
+*
+*  a: first job.
+*  b: second job.
+*
+*  returns: 1 if a must be executed before b, otherwise 0.
+*/
+int queue_before(struct queue_entry *a, struct queue_entry *b)
+{
+    if (ms->queue_policy == QUEUE_PRIORITY && a->priority != b->priority)
+    {
+        return a->priority > b->priority;
+    }
+    return a->seq < b->seq;
+}
+
+/*
+* Function: queue_compare:
+* ------------------------
+* Compares two queued jobs for qsort. A sorted array is also a valid heap.
+*
+*  a: first job.
+*  b: second job.
+*
+*  returns: negative if a goes before b, otherwise positive.
+*/
+int queue_compare(const void *a, const void *b)
+{
+    return queue_before((struct queue_entry *)a, (struct queue_entry *)b) ? -1
+                                                                          : 1;
+}
+
+/*
+* Function: queue_args:
+* ---------------------
+* Copies the arguments of a queued job in a single block, adding "&" at the
+* end if they do not have it.
+*
+*  args: pointer array with the command and its arguments.
+*
+*  returns: the copy, that is freed with free, or NULL if there is no memory.
+*/
+char **queue_args(char **args)
+{
+    int n_args = 0;
+    size_t length = sizeof("&");
+    while (args[n_args])
+    {
+        length += strlen(args[n_args++]) + 1;
+    }
+    int background = n_args && !strcmp(args[n_args - 1], "&");
+    char **copy = malloc(sizeof(char *) * (n_args + 2) + length);
+    if (!copy)
+    {
+        perror("malloc");
+        return NULL;
+    }
+    char *text = (char *)(copy + n_args + 2);
+    for (int i = 0; i < n_args; i++)
+    {
+        copy[i] = strcpy(text, args[i]);
+        text += strlen(text) + 1;
+    }
+    if (!background)
+    {
+        copy[n_args++] = strcpy(text, "&");
+    }
+    copy[n_args] = NULL;
+    return copy;
+}
+
+/*
+* Function: queue_push:
+* ---------------------
+* Adds a job to the heap of the queue.
+*
+*  entry: job to add.
+*
+*  returns: exit success or exit failure if there is no memory.
+*/
+int queue_push(struct queue_entry *entry)
+{
+    // Doubles the size of the heap if it is full.
+    if (ms->n_queue == ms->queue_size)
+    {
+        int size = ms->queue_size ? ms->queue_size * 2 : 64;
+        struct queue_entry *aux = realloc(ms->queue,
+                                          sizeof(struct queue_entry) * size);
+        if (!aux)
+        {
+            perror("realloc");
+            return EXIT_FAILURE;
+        }
+        ms->queue = aux;
+        ms->queue_size = size;
+    }
+    // Inserts the job at the end and moves it up.
+    int pos = ms->n_queue++;
+    while (pos > 0 && queue_before(entry, &ms->queue[(pos - 1) / 2]))
+    {
+        ms->queue[pos] = ms->queue[(pos - 1) / 2];
+        pos = (pos - 1) / 2;
+    }
+    ms->queue[pos] = *entry;
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: queue_pop:
+* --------------------
+* Removes the first job of the heap of the queue.
+*
+*  entry: pointer where the removed job is stored.
+*
+*  returns: exit success or exit failure if the queue is empty.
+*/
+int queue_pop(struct queue_entry *entry)
+{
+    if (!ms->n_queue)
+    {
+        return EXIT_FAILURE;
+    }
+    *entry = ms->queue[0];
+
+    // Moves the last job to the top and moves it down.
+    struct queue_entry last = ms->queue[--ms->n_queue];
+    int pos = 0;
+    while (2 * pos + 1 < ms->n_queue)
+    {
+        int child = 2 * pos + 1;
+        if (child + 1 < ms->n_queue && queue_before(&ms->queue[child + 1],
+                                                &ms->queue[child]))
+        {
+            child++;
+        }
+        if (!queue_before(&ms->queue[child], &last))
+        {
+            break;
+        }
+        ms->queue[pos] = ms->queue[child];
+        pos = child;
+    }
+    ms->queue[pos] = last;
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: queue_pump:
+* ---------------------
+* Launches queued jobs while there are free slots. It is called from the 
+* event loop, so the queue advances when the reaper frees a slot.
+*
+*  returns: the number of jobs launched.
+*/
+int queue_pump()
+{
+    static int pumping = 0;
+    struct queue_entry entry;
+    int launched = 0;
+
+    // Avoids launching jobs from a job that is being launched.
+    if (pumping)
+    {
+        return 0;
+    }
+    pumping = 1;
+    while (ms->n_queue)
+    {
+        // Counts the running background jobs.
+        if (jobs_running() >= ms->queue_slots)
+        {
+            break;
+        }
+        // Executes the first job of the queue keeping the last status. The
+        // arguments are not expanded again, the internal commands receive 
+        // them like from execute_args and the others are launched.
+        queue_pop(&entry);
+        trace_event('i', "dequeue", entry.command_line, entry.priority);
+        int status = ms->last_status;
+        if (check_internal(entry.args))
+        {
+            is_background(entry.args);
+            launch_job(entry.args, entry.command_line, 1, NULL);
+        }
+        ms->last_status = status;
+        free(entry.command_line);
+        free(entry.args);
+        launched++;
+    }
+    pumping = 0;
+    return launched;
+}
+
+/*
+* Function: queue_drain:
+* ----------------------
+* Waits in the event loop until all the queued jobs have been launched.
+*
+*  returns: exit success.
+*/
+int queue_drain()
+{
+    while (ms->n_queue)
+    {
+        event_wait(-1);
+    }
+    return EXIT_SUCCESS;
+}
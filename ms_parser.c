@@ -0,0 +1,317 @@
+/*
+* Parser of libminishell: division of the command lines in tokens and the
+* analysis of the tokens (background, redirections, durations and signals).
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#include "ms_internal.h"
+
+/*
+* Function: parse_args:
+* ---------------------
+* Divides the input line into tokens that are divided by blank spaces " " or
+* tabs and elimintates the content after "#" (they are comments). The blanks
+* inside a command substitution $(...) or `...` do not divide the token.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*  line: pointer where the input introduced by stdin will be stored.
+*
+*  returns: the number of tokens obtained from line.
+*/
+int parse_args(char **args, char *line)
+{
+    // Counter for the tokens and pointer to the current character.
+    int ntoken = 0;
+    char *ptr = line;
+
+    // Checks if line is empty or not.
+    if (line)
+    {
+        // Loop until the end of line, a comment or args is full.
+        while (*ptr && ntoken < ARGS_SIZE - 1)
+        {
+            // Skips the blanks before the token.
+            while (*ptr == ' ' || *ptr == '\t')
+            {
+                ptr++;
+            }
+            // If there is a token that starts with "#" then it is a comment.
+            if (!*ptr || *ptr == '#')
+            {
+                break;
+            }
+            // Saves the token and looks for its end.
+            args[ntoken] = ptr;
+            ntoken++;
+            int depth = 0;
+            int quoted = 0;
+            while (*ptr && (depth || quoted || (*ptr != ' ' && *ptr != '\t')))
+            {
+                if (*ptr == '`')
+                {
+                    quoted = !quoted;
+                }
+                else if (!quoted && ptr[0] == '$' && ptr[1] == '(')
+                {
+                    depth++;
+                    ptr++;
+                }
+                else if (!quoted && depth && *ptr == '(')
+                {
+                    depth++;
+                }
+                else if (!quoted && depth && *ptr == ')')
+                {
+                    depth--;
+                }
+                ptr++;
+            }
+            // Ends the token.
+            if (*ptr)
+            {
+                *ptr = '\0';
+                ptr++;
+            }
+        }
+    }
+    // Adds the sentinel at args.
+    args[ntoken] = NULL;
+    return ntoken;
+}
+
+/*
+* Function: split_list:
+* ---------------------
+* Looks for the end of the first command of a command list, that is, the 
+* first ";", "&&" or "||" out of a command substitution, and ends the command
+* there. The comments end the list.
+*
+*  line: command list.
+*  op: pointer where the operator after the first command is stored (LIST_SEQ,
+*      LIST_AND or LIST_OR).
+*
+*  returns: pointer to the rest of the list or NULL if it was the last command.
+*/
+char *split_list(char *line, int *op)
+{
+    int depth = 0;
+    int quoted = 0;
+    *op = LIST_SEQ;
+    for (char *ptr = line; *ptr; ptr++)
+    {
+        if (*ptr == '`')
+        {
+            quoted = !quoted;
+        }
+        else if (quoted)
+        {
+            continue;
+        }
+        else if (ptr[0] == '$' && ptr[1] == '(')
+        {
+            depth++;
+            ptr++;
+        }
+        else if (depth && *ptr == '(')
+        {
+            depth++;
+        }
+        else if (depth && *ptr == ')')
+        {
+            depth--;
+        }
+        else if (depth)
+        {
+            continue;
+        }
+        // A "#" at the start of a token begins a comment.
+        else if (*ptr == '#' && (ptr == line || ptr[-1] == ' ' ||
+                                 ptr[-1] == '\t'))
+        {
+            *ptr = '\0';
+            return NULL;
+        }
+        else if (*ptr == ';' || (ptr[0] == '&' && ptr[1] == '&') ||
+                 (ptr[0] == '|' && ptr[1] == '|'))
+        {
+            *op = *ptr == ';' ? LIST_SEQ : *ptr == '&' ? LIST_AND : LIST_OR;
+            char *next = ptr + (*ptr == ';' ? 1 : 2);
+            *ptr = '\0';
+            return next;
+        }
+    }
+    return NULL;
+}
+
+/*
+* Function: join_args:
+* --------------------
+* Groups all the tokens of a command line separated by blank spaces. The 
+* command line is cut if it does not fit in COMMAND_LINE_SIZE.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*  command: pointer where the command line will be stored.
+*
+*  returns: pointer to the command line.
+*/
+char *join_args(char **args, char *command)
+{
+    int length = snprintf(command, COMMAND_LINE_SIZE, "%s", args[0]);
+    int i = 1;
+    while (args[i] && length < COMMAND_LINE_SIZE)
+    {
+        length += snprintf(command + length, COMMAND_LINE_SIZE - length,
+                           " %s", args[i]);
+        i++;
+    }
+    return command;
+}
+
+/*
+* Function: is_background:
+* ------------------------
+* Checks if it will be a background process.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: exit success or exit failure if it will be a background process.
+*/
+int is_background(char **args)
+{
+    int ind = 0;
+
+    // Search for the last argument.
+    while (args[ind + 1])
+    {
+        ind++;
+    }
+    // If the last argument contains '&' returns exit failure.
+    if (!strcmp(args[ind], "&"))
+    {
+        args[ind] = NULL;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: is_output_redirection:
+* --------------------------------
+* Checks if there is '>' in the arguments and if so changes it with NULL 
+* and obtains the file name in the argument after the '>' where the output
+* of the command will be saved. 
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: true(0) if there is redirection, false(1) if not.
+*/
+int is_output_redirection(char **args)
+{
+    // Traverses the arguments until the NULL token.
+    int ind = 0;
+    while (args[ind])
+    {
+        // If it finds the token that contains '>' and the next token != NULL.
+        if (!strcmp(args[ind], ">") && args[ind + 1])
+        {
+            args[ind] = NULL;
+
+            // Opens the file and links it with stdout.
+            int fd = open(args[ind + 1], O_WRONLY | O_CREAT | O_TRUNC |
+                          O_CLOEXEC, S_IRUSR | S_IWUSR);
+            dup2(fd, 1);
+            close(fd);
+
+            return 1;
+        }
+        ind++;
+    }
+    return 0;
+}
+
+/*
+* Function: parse_duration:
+* -------------------------
+* Converts a duration with an optional suffix (s, m, h, d) to nanoseconds.
+*
+*  text: duration to convert, for example 1.5m.
+*
+*  returns: the duration in nanoseconds or -1 if it is not valid, infinite 
+*           or too long.
+*/
+long long parse_duration(char *text)
+{
+    char *end;
+    double value = strtod(text, &end);
+    if (end == text || value < 0)
+    {
+        return -1;
+    }
+    // Applies the suffix.
+    if (!strcmp(end, "m"))
+    {
+        value *= 60;
+    }
+    else if (!strcmp(end, "h"))
+    {
+        value *= 3600;
+    }
+    else if (!strcmp(end, "d"))
+    {
+        value *= 86400;
+    }
+    else if (*end && strcmp(end, "s"))
+    {
+        return -1;
+    }
+    // At most a quarter of the range, so the deadline of a timeout (now, 
+    // the duration and the kill after) does not overflow.
+    if (!isfinite(value) || value > LLONG_MAX / 4 / 1e9)
+    {
+        return -1;
+    }
+    return (long long)(value * 1000000000.0);
+}
+
+/*
+* Function: signal_number:
+* ------------------------
+* Converts the name (TERM, SIGTERM) or the number of a signal to its number.
+*
+*  name: name or number of the signal.
+*
+*  returns: the number of the signal or -1 if it is not valid.
+*/
+int signal_number(char *name)
+{
+    const char *names[] = {"HUP", "INT", "QUIT", "KILL", "USR1", "USR2",
+                           "ALRM", "TERM", "CONT", "STOP", "TSTP", NULL};
+    const int numbers[] = {SIGHUP, SIGINT, SIGQUIT, SIGKILL, SIGUSR1, SIGUSR2,
+                           SIGALRM, SIGTERM, SIGCONT, SIGSTOP, SIGTSTP};
+
+    // Checks if it is a number.
+    char *end;
+    long number = strtol(name, &end, 10);
+    if (end != name && !*end)
+    {
+        return number > 0 && number < NSIG ? (int)number : -1;
+    }
+    // Skips the prefix SIG and searches the name.
+    if (!strncmp(name, "SIG", 3))
+    {
+        name += 3;
+    }
+    for (int i = 0; names[i]; i++)
+    {
+        if (!strcmp(name, names[i]))
+        {
+            return numbers[i];
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,412 @@
+/*
+* Pool of sons of libminishell: the internal command pool keeps some sons
+* forked in advance, with the signals already prepared like the son of
+* launch_job, waiting in a socket. When a command is launched, the plan of
+* the command (working directory, arguments and environment) and the
+* current stdin, stdout and stderr are sent to one of them and it only has
+* to execute it. The pool is filled again while the
+* minishell waits in the event loop.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#include "ms_internal.h"
+
+/*
+* Function: internal_pool:
+* ------------------------
+* Changes the number of sons of the pool (pool N, pool off) or shows the
+* sons prepared and the hit rate (pool).
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: exit success or exit failure if the number is not valid.
+*/
+int internal_pool(char **args)
+{
+    // Shows the state of the pool.
+    if (!args[1])
+    {
+        unsigned long launches = ms->pool_hits + ms->pool_misses;
+        printf("pool: %d hijos preparados de %d, %lu aciertos y %lu fallos "
+               "(%.1f%% de aciertos)\n", ms->n_pool, ms->pool_size,
+               ms->pool_hits, ms->pool_misses,
+               launches ? 100.0 * ms->pool_hits / launches : 0.0);
+        return EXIT_SUCCESS;
+    }
+    // Reads the number of sons.
+    char *end;
+    int size = strtol(args[1], &end, 10);
+    if (!strcmp(args[1], "off"))
+    {
+        size = 0;
+    }
+    else if (*end || end == args[1] || size < 0 || size > POOL_SIZE ||
+             args[2])
+    {
+        fprintf(stderr, "La sintaxis es errónea, pool [N | off], N entre 0 "
+                        "y %d\n", POOL_SIZE);
+        return EXIT_FAILURE;
+    }
+    // The sons that are not needed end and the new ones are forked.
+    ms->pool_size = size;
+    if (ms->n_pool > size)
+    {
+        pool_flush();
+    }
+    pool_fill();
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: pool_fill:
+* --------------------
+* Forks the sons that the pool is missing. It is called by the event loop,
+* so the pool is filled while the minishell waits and not when a command is
+* launched.
+*
+*  returns: the number of sons forked.
+*/
+int pool_fill()
+{
+    int filled = 0;
+    while (ms->n_pool < ms->pool_size)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds))
+        {
+            perror("socketpair");
+            break;
+        }
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            close(fds[0]);
+            pool_park(fds[1]);
+        }
+        close(fds[1]);
+        if (pid < 0)
+        {
+            perror("fork");
+            close(fds[0]);
+            break;
+        }
+        ms->pool[ms->n_pool].pid = pid;
+        ms->pool[ms->n_pool].fd = event_high_fd(fds[0]);
+        ms->n_pool++;
+        filled++;
+    }
+    return filled;
+}
+
+/*
+* Function: pool_park:
+* --------------------
+* Executed by a son of the pool: it prepares the signals like the son of
+* launch_job and waits for the plan of its command. While it waits its
+* stdin, stdout and stderr are /dev/null, so it does not keep open a pipe of
+* the minishell (for example of a $(...)); it receives the ones to use with
+* the plan. It ends without output when the minishell closes the socket.
+*
+*  fd: socket where the plan is received.
+*
+*  returns: it does not return.
+*/
+void pool_park(int fd)
+{
+    // Sets ignore for SIGTSTP and SIGINT and standard action for SIGCHILD
+    // and SIGPIPE.
+    signal(SIGTSTP, SIG_IGN);
+    signal(SIGINT, SIG_IGN);
+    signal(SIGCHLD, SIG_DFL);
+    signal(SIGPIPE, SIG_DFL);
+
+    // Closes the descriptors of the minishell, the pipes of the jobs and
+    // the sockets of the other sons of the pool.
+    close_exec_fds(fd);
+    int null = open("/dev/null", O_RDWR | O_CLOEXEC);
+    for (int i = 0; i <= 2 && null >= 0; i++)
+    {
+        dup2(null, i);
+    }
+
+    // Waits for the plan.
+    struct pool_plan header;
+    int stdio[3];
+    if (pool_receive(fd, &header, stdio))
+    {
+        _exit(EXIT_SUCCESS);
+    }
+    for (int i = 0; i <= 2; i++)
+    {
+        dup2(stdio[i], i);
+        close(stdio[i]);
+    }
+    char *data = malloc(header.length);
+    char **args = malloc(sizeof(char *) * (header.n_args + 1));
+    char **env = malloc(sizeof(char *) * (header.n_env + 1));
+    if (!data || !args || !env || pool_read(fd, data, header.length))
+    {
+        _exit(EXIT_FAILURE);
+    }
+    close(fd);
+
+    // The working directory is followed by the arguments and the
+    // environment.
+    char *ptr = data + strlen(data) + 1;
+    for (int i = 0; i < header.n_args; i++)
+    {
+        args[i] = ptr;
+        ptr += strlen(ptr) + 1;
+    }
+    args[header.n_args] = NULL;
+    for (int i = 0; i < header.n_env; i++)
+    {
+        env[i] = ptr;
+        ptr += strlen(ptr) + 1;
+    }
+    env[header.n_env] = NULL;
+    if (chdir(data))
+    {
+        perror(data);
+        _exit(EXIT_FAILURE);
+    }
+    environ = env;
+
+    // Executes the command like the son of launch_job.
+    close_inherited_fds();
+    is_output_redirection(args);
+    trace_event('i', "exec", args[0], 0);
+    execvp(args[0], args);
+    fprintf(stderr, "%s: no se encontró la orden.\n", args[0]);
+    _exit(EXIT_FAILURE);
+}
+
+/*
+* Function: pool_read:
+* --------------------
+* Reads a number of bytes from the socket of a son of the pool.
+*
+*  fd: socket.
+*  buffer: pointer where the bytes are stored.
+*  length: number of bytes to read.
+*
+*  returns: exit success or exit failure if the socket ended before.
+*/
+int pool_read(int fd, void *buffer, size_t length)
+{
+    size_t done = 0;
+    while (done < length)
+    {
+        ssize_t n = read(fd, (char *)buffer + done, length - done);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return EXIT_FAILURE;
+        }
+        done += n;
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: pool_receive:
+* -----------------------
+* Reads the header of the plan from the socket of a son of the pool, with
+* the descriptors for stdin, stdout and stderr that come with it.
+*
+*  fd: socket.
+*  header: pointer where the header is stored.
+*  stdio: array where the three descriptors are stored.
+*
+*  returns: exit success or exit failure if the socket ended before or the
+*           descriptors were not received.
+*/
+int pool_receive(int fd, struct pool_plan *header, int *stdio)
+{
+    char control[CMSG_SPACE(sizeof(int) * 3)];
+    struct iovec iov = {header, sizeof(struct pool_plan)};
+    struct msghdr message = {0};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    ssize_t n;
+    do
+    {
+        n = recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    struct cmsghdr *cmsg = n > 0 ? CMSG_FIRSTHDR(&message) : NULL;
+    if (!cmsg || cmsg->cmsg_level != SOL_SOCKET ||
+        cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len != CMSG_LEN(sizeof(int) * 3))
+    {
+        return EXIT_FAILURE;
+    }
+    memcpy(stdio, CMSG_DATA(cmsg), sizeof(int) * 3);
+    // The rest of the header, if it arrived in more than one read.
+    return pool_read(fd, (char *)header + n, sizeof(struct pool_plan) - n);
+}
+
+/*
+* Function: pool_send:
+* --------------------
+* Sends the plan of a command to a son of the pool. The first bytes carry
+* the current stdin, stdout and stderr of the minishell.
+*
+*  fd: socket of the son.
+*  plan: plan of the command.
+*
+*  returns: exit success or exit failure if the son did not receive it.
+*/
+int pool_send(int fd, struct capture *plan)
+{
+    char control[CMSG_SPACE(sizeof(int) * 3)] = {0};
+    int stdio[3] = {0, 1, 2};
+    size_t done = 0;
+    while (done < plan->length)
+    {
+        struct iovec iov = {plan->data + done, plan->length - done};
+        struct msghdr message = {0};
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+        if (!done)
+        {
+            message.msg_control = control;
+            message.msg_controllen = sizeof(control);
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(int) * 3);
+            memcpy(CMSG_DATA(cmsg), stdio, sizeof(stdio));
+        }
+        ssize_t n = sendmsg(fd, &message, MSG_NOSIGNAL);
+        if (n < 0 && errno != EINTR)
+        {
+            return EXIT_FAILURE;
+        }
+        done += n > 0 ? n : 0;
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: pool_launch:
+* ----------------------
+* Sends the plan of a command to a son of the pool. It is called by
+* launch_job with SIGCHLD blocked, so the son is registered before the
+* reaper can find it.
+*
+*  args: pointer array with the command and its arguments, it can have an
+*        output redirection.
+*
+*  returns: the pid of the son that executes the command or -1 if the pool
+*           is empty or stdin, stdout or stderr is closed and a son has to
+*           be forked.
+*/
+pid_t pool_launch(char **args)
+{
+    if (!ms->pool_size)
+    {
+        return -1;
+    }
+    // The son needs stdin, stdout and stderr to be open to receive them.
+    int closed = 0;
+    for (int i = 0; i <= 2; i++)
+    {
+        closed |= fcntl(i, F_GETFD) < 0;
+    }
+    if (!ms->n_pool || closed)
+    {
+        ms->pool_misses++;
+        return -1;
+    }
+    // Takes the last son and sends it the plan.
+    struct pool_child child = ms->pool[--ms->n_pool];
+    struct capture plan = {NULL, 0, 0};
+    int result = pool_plan(&plan, args) || pool_send(child.fd, &plan);
+    free(plan.data);
+    close(child.fd);
+
+    // If the son did not receive the plan, it ends and a son is forked.
+    if (result)
+    {
+        kill(child.pid, SIGKILL);
+        waitpid(child.pid, NULL, 0);
+        ms->pool_misses++;
+        return -1;
+    }
+    ms->pool_hits++;
+    trace_event('i', "pool", args[0], child.pid);
+    return child.pid;
+}
+
+/*
+* Function: pool_plan:
+* --------------------
+* Builds the plan of a command: the header, the working directory, the
+* arguments and the environment of the minishell.
+*
+*  plan: buffer where the plan is stored.
+*  args: pointer array with the command and its arguments.
+*
+*  returns: exit success or exit failure if there is no memory or the
+*           working directory could not be obtained.
+*/
+int pool_plan(struct capture *plan, char **args)
+{
+    struct pool_plan header = {0, 0, 0};
+    char *cwd = getcwd(NULL, 0);
+    int result = !cwd || capture_append(plan, (char *)&header, sizeof(header))
+                 || capture_append(plan, cwd, strlen(cwd) + 1);
+    free(cwd);
+    for (; !result && args[header.n_args]; header.n_args++)
+    {
+        result = capture_append(plan, args[header.n_args],
+                                strlen(args[header.n_args]) + 1);
+    }
+    for (; !result && environ[header.n_env]; header.n_env++)
+    {
+        result = capture_append(plan, environ[header.n_env],
+                                strlen(environ[header.n_env]) + 1);
+    }
+    if (result)
+    {
+        return EXIT_FAILURE;
+    }
+    header.length = plan->length - sizeof(header);
+    memcpy(plan->data, &header, sizeof(header));
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: pool_flush:
+* ---------------------
+* Ends the sons of the pool and waits for them, so they are not notified
+* as finished jobs. It is used when the sons would not execute the commands
+* like a new son (the limits or the descriptors of the minishell have
+* changed) and before exec. The event loop fills the pool again.
+*
+*  returns: void.
+*/
+void pool_flush()
+{
+    sigset_t mask, old_mask;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGCHLD);
+    sigprocmask(SIG_BLOCK, &mask, &old_mask);
+    while (ms->n_pool)
+    {
+        ms->n_pool--;
+        close(ms->pool[ms->n_pool].fd);
+        waitpid(ms->pool[ms->n_pool].pid, NULL, 0);
+    }
+    sigprocmask(SIG_SETMASK, &old_mask, NULL);
+}
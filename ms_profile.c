@@ -0,0 +1,409 @@
+/*
+* Profiler of scripts of libminishell: source --profile fichero executes a
+* script and measures, for each line and for each internal command, the
+* time of execution, the CPU of the sons and the number of sons created.
+* The executions of the same line are added. The lines executed by a nested
+* source or by a function are measured inside the line that called them.
+* At the end a report sorted by time is printed, or the stacks of lines are
+* written in the collapsed format of the flame graphs.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#include "ms_internal.h"
+
+/*
+* Function: profile_source:
+* -------------------------
+* Executes a script measuring its lines. If a script is already profiled
+* (a nested source --profile), its lines are added to that profile.
+*
+*  path: name of the script file.
+*  output: file for the collapsed stacks, NULL to print the report.
+*
+*  returns: the exit status of the last command or exit failure if an error
+*           with the file happens.
+*/
+int profile_source(char *path, const char *output)
+{
+    if (ms->profile)
+    {
+        return source_file(path, 0);
+    }
+    ms->profile = calloc(1, sizeof(struct profile));
+    if (!ms->profile)
+    {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+    ms->profile->output = output;
+    ms->profile->start = monotonic_ns();
+    ms->profile->cpu = profile_cpu();
+    ms->profile->sons = ms->n_sons;
+    int result = source_file(path, 0);
+    profile_finish();
+    return result;
+}
+
+/*
+* Function: profile_begin:
+* ------------------------
+* Starts measuring a line of the profiled script. It is called by
+* script_simple_run before executing the command.
+*
+*  node: node of the command.
+*  tokens: tokens of the command, before they are modified by the execution.
+*
+*  returns: 1 if the line is measured and profile_end has to be called, 0 if
+*           it is not (too many nested lines or no memory).
+*/
+int profile_begin(struct script_node *node, char **tokens)
+{
+    struct profile *profile = ms->profile;
+    if (profile->n_frames == PROFILE_DEPTH)
+    {
+        return 0;
+    }
+    char key[COMMAND_LINE_SIZE];
+    snprintf(key, sizeof(key), "%s:%d", profile->path ? profile->path : "-",
+             node->line);
+    struct profile_entry *entry = profile_find(PROFILE_LINE, key);
+    if (!entry)
+    {
+        return 0;
+    }
+    // The text of the line is saved the first time it is executed.
+    if (!entry->text)
+    {
+        char text[COMMAND_LINE_SIZE] = "";
+        size_t used = 0;
+        for (int i = 0; tokens[i] && used < sizeof(text) - 1; i++)
+        {
+            used += snprintf(text + used, sizeof(text) - used, "%s%s",
+                             i ? " " : "", tokens[i]);
+        }
+        entry->text = strdup(text);
+    }
+    struct profile_frame *frame = &profile->frames[profile->n_frames++];
+    frame->entry = entry;
+    frame->cpu = profile_cpu();
+    frame->sons = ms->n_sons;
+    frame->nested = 0;
+    frame->start = monotonic_ns();
+    return 1;
+}
+
+/*
+* Function: profile_end:
+* ----------------------
+* Ends measuring the last line started and adds its values to the line and
+* to its stack. The time of the line is nested time for the line that
+* contains it.
+*
+*  returns: void.
+*/
+void profile_end()
+{
+    struct profile *profile = ms->profile;
+    struct profile_frame *frame = &profile->frames[--profile->n_frames];
+    long long wall = monotonic_ns() - frame->start;
+    long long cpu = profile_cpu() - frame->cpu;
+    unsigned long sons = ms->n_sons - frame->sons;
+    frame->entry->count++;
+    frame->entry->wall += wall;
+    frame->entry->cpu += cpu;
+    frame->entry->sons += sons;
+    profile->n_lines++;
+    if (profile->n_frames)
+    {
+        profile->frames[profile->n_frames - 1].nested += wall;
+    }
+    // The stack has the key and the first word of each line in execution,
+    // a ';' in them is changed because it separates the lines.
+    struct capture stack = {NULL, 0, 0};
+    int result = 0;
+    for (int i = 0; i <= profile->n_frames && !result; i++)
+    {
+        struct profile_entry *line = profile->frames[i].entry;
+        const char *text = line->text ? line->text : "";
+        size_t start = stack.length;
+        result = (i && capture_append(&stack, ";", 1)) ||
+                 capture_append(&stack, line->key, strlen(line->key)) ||
+                 capture_append(&stack, " ", 1) ||
+                 capture_append(&stack, text, strcspn(text, " "));
+        for (size_t j = start + (i > 0); !result && j < stack.length; j++)
+        {
+            stack.data[j] = stack.data[j] == ';' ? ',' : stack.data[j];
+        }
+    }
+    if (!result && !capture_append(&stack, "", 1))
+    {
+        struct profile_entry *entry = profile_find(PROFILE_STACK, stack.data);
+        if (entry)
+        {
+            entry->count++;
+            entry->wall += wall - frame->nested;
+            entry->cpu += cpu;
+            entry->sons += sons;
+        }
+    }
+    free(stack.data);
+}
+
+/*
+* Function: profile_builtin:
+* --------------------------
+* Executes an internal command measuring it. It is called by check_internal
+* while a script is profiled.
+*
+*  entry: entry of the command in the table of commands.
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: the exit status of the internal command.
+*/
+int profile_builtin(struct command_entry *entry, char **args)
+{
+    struct profile_entry *profiled = profile_find(PROFILE_BUILTIN,
+                                                  entry->name);
+    long long cpu = profile_cpu();
+    unsigned long sons = ms->n_sons;
+    long long start = monotonic_ns();
+    int status = entry->builtin(args);
+    if (profiled)
+    {
+        profiled->count++;
+        profiled->wall += monotonic_ns() - start;
+        profiled->cpu += profile_cpu() - cpu;
+        profiled->sons += ms->n_sons - sons;
+    }
+    return status;
+}
+
+/*
+* Function: profile_find:
+* -----------------------
+* Looks for an entry of the profile and creates it if it does not exist.
+*
+*  kind: PROFILE_LINE, PROFILE_BUILTIN or PROFILE_STACK.
+*  key: key of the entry.
+*
+*  returns: the entry or NULL if there is no memory.
+*/
+struct profile_entry *profile_find(int kind, const char *key)
+{
+    unsigned int hash = 2166136261u;
+    for (const char *ptr = key; *ptr; ptr++)
+    {
+        hash = (hash ^ (unsigned char)*ptr) * 16777619u;
+    }
+    hash = (hash ^ kind) % PROFILE_SIZE;
+    struct profile_entry *entry = ms->profile->table[hash];
+    while (entry && (entry->kind != kind || strcmp(entry->key, key)))
+    {
+        entry = entry->next;
+    }
+    if (entry)
+    {
+        return entry;
+    }
+    entry = calloc(1, sizeof(struct profile_entry));
+    if (!entry || !(entry->key = strdup(key)))
+    {
+        perror("calloc");
+        free(entry);
+        return NULL;
+    }
+    entry->kind = kind;
+    entry->next = ms->profile->table[hash];
+    ms->profile->table[hash] = entry;
+    return entry;
+}
+
+/*
+* Function: profile_cpu:
+* ----------------------
+* Returns the CPU used by the sons that have been waited.
+*
+*  returns: nanoseconds of CPU, user and system.
+*/
+long long profile_cpu()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_CHILDREN, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000000LL +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1000LL;
+}
+
+/*
+* Function: profile_finish:
+* -------------------------
+* Ends the profile: prints the report in stderr or writes the collapsed
+* stacks and frees the entries. It is also called by exit, so a script that
+* ends with exit is reported.
+*
+*  returns: void.
+*/
+void profile_finish()
+{
+    struct profile *profile = ms->profile;
+    if (!profile)
+    {
+        return;
+    }
+    long long wall = monotonic_ns() - profile->start;
+    if (profile->output)
+    {
+        profile_write(profile->output);
+    }
+    else
+    {
+        fflush(stdout);
+        fprintf(stderr, "profile: %lu líneas ejecutadas en %.3f s, CPU de los "
+                        "hijos %.3f s, %lu hijos\n", profile->n_lines,
+                wall / 1e9, (profile_cpu() - profile->cpu) / 1e9,
+                ms->n_sons - profile->sons);
+        profile_print(PROFILE_LINE, "línea", wall);
+        profile_print(PROFILE_BUILTIN, "orden interna", wall);
+    }
+    // Frees the entries.
+    for (int i = 0; i < PROFILE_SIZE; i++)
+    {
+        while (profile->table[i])
+        {
+            struct profile_entry *entry = profile->table[i];
+            profile->table[i] = entry->next;
+            free(entry->key);
+            free(entry->text);
+            free(entry);
+        }
+    }
+    free(profile);
+    ms->profile = NULL;
+}
+
+/*
+* Function: profile_print:
+* ------------------------
+* Prints in stderr the PROFILE_REPORT entries of a kind with more time. The
+* time of a line includes the lines executed inside it.
+*
+*  kind: PROFILE_LINE or PROFILE_BUILTIN.
+*  title: name of the column of the entries.
+*  total: nanoseconds of the whole profile, for the percentages.
+*
+*  returns: void.
+*/
+void profile_print(int kind, const char *title, long long total)
+{
+    // Sorts the entries of the kind.
+    int n_entries = 0;
+    for (int i = 0; i < PROFILE_SIZE; i++)
+    {
+        for (struct profile_entry *entry = ms->profile->table[i]; entry;
+             entry = entry->next)
+        {
+            n_entries += entry->kind == kind && entry->count;
+        }
+    }
+    if (!n_entries)
+    {
+        return;
+    }
+    struct profile_entry **entries = malloc(sizeof(struct profile_entry *) *
+                                            n_entries);
+    if (!entries)
+    {
+        perror("malloc");
+        return;
+    }
+    int n = 0;
+    for (int i = 0; i < PROFILE_SIZE; i++)
+    {
+        for (struct profile_entry *entry = ms->profile->table[i]; entry;
+             entry = entry->next)
+        {
+            if (entry->kind == kind && entry->count)
+            {
+                entries[n++] = entry;
+            }
+        }
+    }
+    qsort(entries, n_entries, sizeof(struct profile_entry *),
+          profile_compare);
+
+    // Prints the entries with more time.
+    fprintf(stderr, "%12s %6s %8s %13s %7s  %s\n", "tiempo ms", "%",
+            "veces", "CPU hijos ms", "hijos", title);
+    for (int i = 0; i < n_entries && i < PROFILE_REPORT; i++)
+    {
+        fprintf(stderr, "%12.3f %6.1f %8lu %13.3f %7lu  %s%s%s\n",
+                entries[i]->wall / 1e6,
+                total > 0 ? 100.0 * entries[i]->wall / total : 0.0,
+                entries[i]->count, entries[i]->cpu / 1e6, entries[i]->sons,
+                entries[i]->key, entries[i]->text ? ": " : "",
+                entries[i]->text ? entries[i]->text : "");
+    }
+    if (n_entries > PROFILE_REPORT)
+    {
+        fprintf(stderr, "(%d más)\n", n_entries - PROFILE_REPORT);
+    }
+    free(entries);
+}
+
+/*
+* Function: profile_write:
+* ------------------------
+* Writes the stacks of lines in the collapsed format of the flame graphs:
+* one line per stack with the lines separated by ';' and the microseconds
+* of the last line without the lines executed inside it.
+*
+*  path: name of the file.
+*
+*  returns: exit success or exit failure if the file could not be written.
+*/
+int profile_write(const char *path)
+{
+    FILE *fp = fopen(path, "we");
+    if (!fp)
+    {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < PROFILE_SIZE; i++)
+    {
+        for (struct profile_entry *entry = ms->profile->table[i]; entry;
+             entry = entry->next)
+        {
+            if (entry->kind == PROFILE_STACK)
+            {
+                fprintf(fp, "%s %lld\n", entry->key,
+                        (entry->wall + 500) / 1000);
+            }
+        }
+    }
+    if (fclose(fp))
+    {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: profile_compare:
+* --------------------------
+* Compares two entries of the profile for qsort, the one with more time
+* goes first.
+*
+*  returns: negative, zero or positive.
+*/
+int profile_compare(const void *a, const void *b)
+{
+    const struct profile_entry *x = *(struct profile_entry *const *)a;
+    const struct profile_entry *y = *(struct profile_entry *const *)b;
+    return (x->wall < y->wall) - (x->wall > y->wall);
+}
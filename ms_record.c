@@ -0,0 +1,264 @@
+/*
+* Recorder of sessions of libminishell: the internal command record saves
+* each command line executed in the minishell, with the time when it was
+* executed, the time it needed and its exit status, in a binary file. The
+* internal command replay executes the lines of a recorded session again,
+* with the original pauses or as fast as possible, and compares the times.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#include "ms_internal.h"
+
+/*
+* Function: internal_record:
+* --------------------------
+* Starts recording the lines of the session in a file (record fichero),
+* stops the recording (record stop) or shows its state (record).
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: exit success or exit failure if the file could not be created.
+*/
+int internal_record(char **args)
+{
+    // Shows the state of the recording.
+    if (!args[1])
+    {
+        if (ms->record_fd < 0)
+        {
+            printf("record: no se está grabando\n");
+        }
+        else
+        {
+            printf("record: grabando, %lu líneas\n", ms->n_recorded);
+        }
+        return EXIT_SUCCESS;
+    }
+    if (args[2])
+    {
+        fprintf(stderr, "La sintaxis es errónea, record [fichero | stop]\n");
+        return EXIT_FAILURE;
+    }
+    // Stops the previous recording.
+    if (ms->record_fd >= 0)
+    {
+        close(ms->record_fd);
+        ms->record_fd = -1;
+    }
+    if (!strcmp(args[1], "stop"))
+    {
+        return EXIT_SUCCESS;
+    }
+    // Creates the file with the header.
+    int fd = open(args[1], O_WRONLY | O_CREAT | O_TRUNC | O_APPEND |
+                  O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+    {
+        perror(args[1]);
+        return EXIT_FAILURE;
+    }
+    struct record_header header;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    memcpy(header.magic, RECORD_MAGIC, sizeof(header.magic));
+    header.started = (long long)now.tv_sec * 1000000000LL + now.tv_nsec;
+    if (write(fd, &header, sizeof(header)) != sizeof(header))
+    {
+        perror(args[1]);
+        close(fd);
+        return EXIT_FAILURE;
+    }
+    ms->record_fd = event_high_fd(fd);
+    ms->record_start = monotonic_ns();
+    ms->n_recorded = 0;
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: record_line:
+* ----------------------
+* Adds a line to the recorded session. The entry and the line are written
+* with a single writev, so the file always has whole entries.
+*
+*  line: command line executed.
+*  start: monotonic time when the line started.
+*  duration: nanoseconds that the line needed.
+*  status: exit status of the line.
+*
+*  returns: exit success or exit failure if it could not be written, then
+*           the recording stops.
+*/
+int record_line(const char *line, long long start, long long duration,
+                int status)
+{
+    // The empty lines and the lines of record and replay are not recorded.
+    const char *ptr = line;
+    while (*ptr == ' ' || *ptr == '\t')
+    {
+        ptr++;
+    }
+    size_t length = strcspn(ptr, " \t;&|");
+    if (!length || (length == 6 && (!strncmp(ptr, "record", 6) ||
+                                    !strncmp(ptr, "replay", 6))))
+    {
+        return EXIT_SUCCESS;
+    }
+    struct record_entry entry;
+    entry.offset = start - ms->record_start;
+    entry.duration = duration;
+    entry.status = status;
+    entry.length = strlen(line);
+    struct iovec iov[2] = {{&entry, sizeof(entry)},
+                           {(void *)line, entry.length}};
+    if (writev(ms->record_fd, iov, 2) != (ssize_t)(sizeof(entry) +
+                                                     entry.length))
+    {
+        perror("record");
+        close(ms->record_fd);
+        ms->record_fd = -1;
+        return EXIT_FAILURE;
+    }
+    ms->n_recorded++;
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: internal_replay:
+* --------------------------
+* Executes again the lines of a session recorded with record: replay [-m]
+* fichero. The lines are executed with the pauses of the recording, or one
+* after the other with -m. For each line the recorded time, the new time,
+* the difference and the statuses that have changed are shown in stderr,
+* and a summary at the end. Ctrl+C stops the replay.
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: exit success if all the lines ended with their recorded status,
+*           exit failure if not or if the file is not valid, 130 if it is
+*           interrupted.
+*/
+int internal_replay(char **args)
+{
+    int fast = args[1] && !strcmp(args[1], "-m");
+    char *path = args[1 + fast];
+    if (!path || args[2 + fast])
+    {
+        fprintf(stderr, "La sintaxis es errónea, replay [-m] fichero\n");
+        return EXIT_FAILURE;
+    }
+    // Reads the whole session.
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+    struct capture session = {NULL, 0, 0};
+    int result = capture_read(fd, &session);
+    close(fd);
+    if (result || session.length < sizeof(struct record_header) ||
+        memcmp(session.data, RECORD_MAGIC, sizeof(RECORD_MAGIC) - 1))
+    {
+        fprintf(stderr, "replay: %s no es una sesión grabada\n", path);
+        free(session.data);
+        return EXIT_FAILURE;
+    }
+    // Executes the lines.
+    char line[COMMAND_LINE_SIZE];
+    long long base = monotonic_ns();
+    long long recorded = 0;
+    long long replayed = 0;
+    int n_lines = 0;
+    int n_changed = 0;
+    size_t position = sizeof(struct record_header);
+    ms->interrupted = 0;
+    while (position + sizeof(struct record_entry) <= session.length &&
+           !ms->interrupted)
+    {
+        struct record_entry entry;
+        memcpy(&entry, session.data + position, sizeof(entry));
+        position += sizeof(entry);
+        if (entry.length > session.length - position)
+        {
+            fprintf(stderr, "replay: %s está incompleto\n", path);
+            break;
+        }
+        snprintf(line, sizeof(line), "%.*s", (int)entry.length,
+                 session.data + position);
+        position += entry.length;
+
+        // Waits until the time of the line in the recording.
+        if (!fast && replay_wait(base + entry.offset))
+        {
+            break;
+        }
+        long long start = monotonic_ns();
+        execute_line(line);
+        long long duration = monotonic_ns() - start;
+        jobs_notify();
+
+        // Compares the line with the recording.
+        snprintf(line, sizeof(line), "%.*s", (int)entry.length,
+                 session.data + position - entry.length);
+        fflush(stdout);
+        fprintf(stderr, "replay: %d: %.3f ms -> %.3f ms", n_lines + 1,
+                entry.duration / 1e6, duration / 1e6);
+        if (entry.duration > 0)
+        {
+            fprintf(stderr, " (%+.1f%%)",
+                    100.0 * (duration - entry.duration) / entry.duration);
+        }
+        if (ms->last_status != entry.status)
+        {
+            fprintf(stderr, ", estado %d -> %d", entry.status,
+                    ms->last_status);
+            n_changed++;
+        }
+        fprintf(stderr, ": %s\n", line);
+        recorded += entry.duration;
+        replayed += duration;
+        n_lines++;
+    }
+    free(session.data);
+
+    // Shows the summary.
+    fprintf(stderr, "replay: %d líneas, %.3f s -> %.3f s", n_lines,
+            recorded / 1e9, replayed / 1e9);
+    if (recorded > 0)
+    {
+        fprintf(stderr, " (%+.1f%%)", 100.0 * (replayed - recorded) / recorded);
+    }
+    fprintf(stderr, ", %d con otro estado\n", n_changed);
+    if (ms->interrupted)
+    {
+        return 130;
+    }
+    return n_changed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*
+* Function: replay_wait:
+* ----------------------
+* Sleeps until a monotonic time. The signals of the finished jobs do not
+* end the wait, Ctrl+C does.
+*
+*  deadline: monotonic time in nanoseconds.
+*
+*  returns: 0 when the time arrives, 1 if Ctrl+C has been pressed.
+*/
+int replay_wait(long long deadline)
+{
+    struct timespec until;
+    until.tv_sec = deadline / 1000000000LL;
+    until.tv_nsec = deadline % 1000000000LL;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) ==
+           EINTR && !ms->interrupted)
+    {
+    }
+    return ms->interrupted != 0;
+}
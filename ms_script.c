@@ -0,0 +1,1450 @@
+/*
+* Scripts of libminishell: the scripts executed with source are compiled once
+* to a tree of nodes (commands, lists, &&, ||, if, while, until, for, case,
+* groups { ...; } and functions) and then the tree is executed, so the loops
+* and the functions do not analyze the lines again and the internal commands
+* run inside the minishell.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#include "ms_internal.h"
+
+/*
+* Function: script_compile:
+* -------------------------
+* Compiles the text of a script to a tree of nodes.
+*
+*  path: name of the script, used in the errors.
+*  text: text of the script ended with '\0'. The tree does not use it once
+*        it has been compiled.
+*
+*  returns: node with the list of commands of the script or NULL if there is
+*           a syntax error.
+*/
+struct script_node *script_compile(const char *path, char *text)
+{
+    struct script_lexer lexer = {path, text, 1, TOKEN_END, text, 0, 1, 0, 0};
+    script_next(&lexer);
+    struct script_node *script = script_list(&lexer);
+
+    // The list only ends before the end of the script with a wrong keyword.
+    if (lexer.type != TOKEN_END)
+    {
+        script_error(&lexer, NULL);
+    }
+    return script_check(&lexer, script);
+}
+
+/*
+* Function: script_list:
+* ----------------------
+* Compiles a list of commands separated by ";" or new lines. The list ends
+* with the end of the script, ";;" or a keyword that ends a block (then,
+* elif, else, fi, do, done, esac and }).
+*
+*  lexer: lexical analyzer at the first token of the list.
+*
+*  returns: node of the list or NULL if there is an error.
+*/
+struct script_node *script_list(struct script_lexer *lexer)
+{
+    struct script_node *list = script_node(lexer, NODE_LIST);
+    struct script_node **last = list ? &list->body : NULL;
+    while (list && !lexer->error)
+    {
+        // Skips the empty commands and remembers the new lines.
+        int newline = 0;
+        int blank = 0;
+        while (lexer->type == TOKEN_NEWLINE || lexer->type == TOKEN_SEMI)
+        {
+            newline |= lexer->type == TOKEN_NEWLINE;
+            blank |= lexer->blank;
+            script_next(lexer);
+        }
+        if (lexer->type == TOKEN_END || lexer->type == TOKEN_DSEMI ||
+            script_list_end(lexer))
+        {
+            break;
+        }
+        struct script_node *node = script_and_or(lexer);
+        if (!node)
+        {
+            break;
+        }
+        node->newline = newline;
+        node->blank = blank && list->body;
+        *last = node;
+        last = &node->next;
+
+        // After a command there must be a separator or the end of the list.
+        if (lexer->type != TOKEN_NEWLINE && lexer->type != TOKEN_SEMI &&
+            lexer->type != TOKEN_END && lexer->type != TOKEN_DSEMI &&
+            !script_list_end(lexer))
+        {
+            script_error(lexer, NULL);
+        }
+    }
+    return script_check(lexer, list);
+}
+
+/*
+* Function: script_and_or:
+* ------------------------
+* Compiles commands joined with "&&" and "||". The operators have the same
+* priority and are grouped from left to right.
+*
+*  lexer: lexical analyzer at the first token of the command.
+*
+*  returns: node of the commands or NULL if there is an error.
+*/
+struct script_node *script_and_or(struct script_lexer *lexer)
+{
+    struct script_node *left = script_command(lexer);
+    while (left && (lexer->type == TOKEN_AND || lexer->type == TOKEN_OR))
+    {
+        struct script_node *node = script_node(lexer, lexer->type == TOKEN_AND
+                                                      ? NODE_AND : NODE_OR);
+        if (!node)
+        {
+            break;
+        }
+        node->condition = left;
+        left = node;
+
+        // The command after the operator can be in the next line.
+        do
+        {
+            script_next(lexer);
+        } while (lexer->type == TOKEN_NEWLINE);
+        node->body = script_command(lexer);
+    }
+    return script_check(lexer, left);
+}
+
+/*
+* Function: script_command:
+* -------------------------
+* Compiles a command: a compound command if it starts with a keyword,
+* otherwise a simple command.
+*
+*  lexer: lexical analyzer at the first token of the command.
+*
+*  returns: node of the command or NULL if there is an error.
+*/
+struct script_node *script_command(struct script_lexer *lexer)
+{
+    if (lexer->type != TOKEN_WORD)
+    {
+        script_error(lexer, NULL);
+        return NULL;
+    }
+    if (script_is_word(lexer, "if"))
+    {
+        return script_if(lexer);
+    }
+    if (script_is_word(lexer, "while") || script_is_word(lexer, "until"))
+    {
+        return script_loop(lexer);
+    }
+    if (script_is_word(lexer, "for"))
+    {
+        return script_for(lexer);
+    }
+    if (script_is_word(lexer, "case"))
+    {
+        return script_case(lexer);
+    }
+    if (script_is_word(lexer, "{"))
+    {
+        return script_group(lexer);
+    }
+    if (script_is_word(lexer, "break") || script_is_word(lexer, "continue") ||
+        script_is_word(lexer, "return"))
+    {
+        return script_jump(lexer);
+    }
+    return script_simple(lexer);
+}
+
+/*
+* Function: script_simple:
+* ------------------------
+* Compiles a simple command, the words until the next operator. The words are
+* kept divided in tokens so they are not analyzed again when it is executed.
+* A word followed by "()" starts the definition of a function.
+*
+*  lexer: lexical analyzer at the first word of the command.
+*
+*  returns: node of the command or NULL if there is an error.
+*/
+struct script_node *script_simple(struct script_lexer *lexer)
+{
+    struct script_node *node = script_node(lexer, NODE_COMMAND);
+    while (node && lexer->type == TOKEN_WORD && !lexer->error)
+    {
+        script_add_word(lexer, node);
+        script_next(lexer);
+        if (node->n_words == 1 && lexer->type == TOKEN_LPAREN)
+        {
+            return script_function(lexer, node);
+        }
+    }
+    return script_check(lexer, node);
+}
+
+/*
+* Function: script_function:
+* --------------------------
+* Compiles name() compound-command, usually name() { commands; }. The body 
+* is saved when the definition is executed.
+*
+*  lexer: lexical analyzer at "(".
+*  node: node with the name of the function, it becomes the definition.
+*
+*  returns: node of the definition or NULL if there is an error.
+*/
+struct script_node *script_function(struct script_lexer *lexer,
+                                    struct script_node *node)
+{
+    node->type = NODE_FUNCTION;
+    if (!script_valid_name(node->words.data, node->words.length - 1))
+    {
+        fprintf(stderr, "%s:%d: nombre de función no válido: %s\n",
+                lexer->path, node->line, node->words.data);
+        lexer->error = 1;
+        return script_check(lexer, node);
+    }
+    if (script_next(lexer) != TOKEN_RPAREN)
+    {
+        script_error(lexer, ")");
+        return script_check(lexer, node);
+    }
+    do
+    {
+        script_next(lexer);
+    } while (lexer->type == TOKEN_NEWLINE);
+
+    // The body has to be a compound command.
+    const char *compounds[] = {"{", "if", "while", "until", "for", "case",
+                               NULL};
+    int compound = 0;
+    for (int i = 0; compounds[i]; i++)
+    {
+        compound |= script_is_word(lexer, compounds[i]);
+    }
+    if (!compound)
+    {
+        script_error(lexer, "{");
+        return script_check(lexer, node);
+    }
+    node->body = script_command(lexer);
+    return script_check(lexer, node);
+}
+
+/*
+* Function: script_if:
+* --------------------
+* Compiles if condition; then commands [elif condition; then commands]...
+* [else commands] fi. Each elif is compiled as an if in the else part of the
+* previous one.
+*
+*  lexer: lexical analyzer at the keyword if or elif.
+*
+*  returns: node of the if or NULL if there is an error.
+*/
+struct script_node *script_if(struct script_lexer *lexer)
+{
+    struct script_node *node = script_node(lexer, NODE_IF);
+    script_next(lexer);
+    if (node)
+    {
+        node->condition = script_list(lexer);
+        if (script_expect(lexer, "then"))
+        {
+            node->body = script_list(lexer);
+        }
+        // The last elif reads the fi of all of them.
+        if (script_is_word(lexer, "elif"))
+        {
+            node->orelse = script_if(lexer);
+        }
+        else
+        {
+            if (script_is_word(lexer, "else"))
+            {
+                script_next(lexer);
+                node->orelse = script_list(lexer);
+            }
+            script_expect(lexer, "fi");
+        }
+    }
+    return script_check(lexer, node);
+}
+
+/*
+* Function: script_loop:
+* ----------------------
+* Compiles while condition; do commands; done and until condition; do
+* commands; done.
+*
+*  lexer: lexical analyzer at the keyword while or until.
+*
+*  returns: node of the loop or NULL if there is an error.
+*/
+struct script_node *script_loop(struct script_lexer *lexer)
+{
+    struct script_node *node = script_node(lexer, script_is_word(lexer,
+                                          "while") ? NODE_WHILE : NODE_UNTIL);
+    script_next(lexer);
+    if (node)
+    {
+        node->condition = script_list(lexer);
+        if (script_expect(lexer, "do"))
+        {
+            node->body = script_list(lexer);
+            script_expect(lexer, "done");
+        }
+    }
+    return script_check(lexer, node);
+}
+
+/*
+* Function: script_for:
+* ---------------------
+* Compiles for NAME in words; do commands; done. The first word of the node
+* is the name of the variable and the rest are the values, they are expanded
+* each time the loop starts.
+*
+*  lexer: lexical analyzer at the keyword for.
+*
+*  returns: node of the loop or NULL if there is an error.
+*/
+struct script_node *script_for(struct script_lexer *lexer)
+{
+    struct script_node *node = script_node(lexer, NODE_FOR);
+    script_next(lexer);
+    if (!node)
+    {
+        return NULL;
+    }
+    // Checks the name of the variable.
+    if (lexer->type != TOKEN_WORD ||
+        !script_valid_name(lexer->token, lexer->length))
+    {
+        script_error(lexer, "variable");
+        return script_check(lexer, node);
+    }
+    script_add_word(lexer, node);
+    script_next(lexer);
+    while (lexer->type == TOKEN_NEWLINE)
+    {
+        script_next(lexer);
+    }
+    // Obtains the values until the end of the line or ";".
+    if (script_expect(lexer, "in"))
+    {
+        while (lexer->type == TOKEN_WORD && !lexer->error)
+        {
+            script_add_word(lexer, node);
+            script_next(lexer);
+        }
+        if (lexer->type == TOKEN_SEMI || lexer->type == TOKEN_NEWLINE)
+        {
+            script_next(lexer);
+        }
+        while (lexer->type == TOKEN_NEWLINE)
+        {
+            script_next(lexer);
+        }
+        if (script_expect(lexer, "do"))
+        {
+            node->body = script_list(lexer);
+            script_expect(lexer, "done");
+        }
+    }
+    return script_check(lexer, node);
+}
+
+/*
+* Function: script_case:
+* ----------------------
+* Compiles case word in [(]pattern[|pattern]...) commands;; ... esac. Each
+* group of patterns is a node of type NODE_PATTERN with its commands.
+*
+*  lexer: lexical analyzer at the keyword case.
+*
+*  returns: node of the case or NULL if there is an error.
+*/
+struct script_node *script_case(struct script_lexer *lexer)
+{
+    struct script_node *node = script_node(lexer, NODE_CASE);
+    script_next(lexer);
+    if (!node)
+    {
+        return NULL;
+    }
+    if (lexer->type != TOKEN_WORD)
+    {
+        script_error(lexer, NULL);
+        return script_check(lexer, node);
+    }
+    script_add_word(lexer, node);
+    script_next(lexer);
+    while (lexer->type == TOKEN_NEWLINE)
+    {
+        script_next(lexer);
+    }
+    script_expect(lexer, "in");
+
+    // Compiles the patterns until esac.
+    struct script_node **last = &node->body;
+    while (!lexer->error)
+    {
+        while (lexer->type == TOKEN_NEWLINE)
+        {
+            script_next(lexer);
+        }
+        if (script_is_word(lexer, "esac"))
+        {
+            break;
+        }
+        struct script_node *pattern = script_node(lexer, NODE_PATTERN);
+        if (!pattern)
+        {
+            break;
+        }
+        *last = pattern;
+        last = &pattern->next;
+        if (lexer->type == TOKEN_LPAREN)
+        {
+            script_next(lexer);
+        }
+        // The patterns are separated by "|" and end with ")".
+        while (lexer->type == TOKEN_WORD && !lexer->error)
+        {
+            script_add_word(lexer, pattern);
+            script_next(lexer);
+            if (lexer->type != TOKEN_PIPE)
+            {
+                break;
+            }
+            script_next(lexer);
+        }
+        if (!pattern->n_words || lexer->type != TOKEN_RPAREN)
+        {
+            script_error(lexer, ")");
+            break;
+        }
+        script_next(lexer);
+        pattern->body = script_list(lexer);
+
+        // The ";;" of the last pattern can be omitted.
+        if (lexer->type == TOKEN_DSEMI)
+        {
+            script_next(lexer);
+        }
+        else if (!script_is_word(lexer, "esac"))
+        {
+            script_error(lexer, ";;");
+        }
+    }
+    script_expect(lexer, "esac");
+    return script_check(lexer, node);
+}
+
+/*
+* Function: script_group:
+* -----------------------
+* Compiles { commands; }, that is a list.
+*
+*  lexer: lexical analyzer at the keyword {.
+*
+*  returns: node of the list or NULL if there is an error.
+*/
+struct script_node *script_group(struct script_lexer *lexer)
+{
+    script_next(lexer);
+    struct script_node *list = script_list(lexer);
+    script_expect(lexer, "}");
+    return script_check(lexer, list);
+}
+
+/*
+* Function: script_jump:
+* ----------------------
+* Compiles break [n], continue [n] and return [n].
+*
+*  lexer: lexical analyzer at the keyword break, continue or return.
+*
+*  returns: node of the jump or NULL if there is an error.
+*/
+struct script_node *script_jump(struct script_lexer *lexer)
+{
+    int type = script_is_word(lexer, "break") ? NODE_BREAK :
+               script_is_word(lexer, "continue") ? NODE_CONTINUE : NODE_RETURN;
+    struct script_node *node = script_node(lexer, type);
+    script_next(lexer);
+    if (node)
+    {
+        // By default one loop or the last status.
+        node->count = type == NODE_RETURN ? -1 : 1;
+        if (lexer->type == TOKEN_WORD)
+        {
+            char *end;
+            node->count = (int)strtol(lexer->token, &end, 10);
+            if (end != lexer->token + lexer->length ||
+                node->count < (type == NODE_RETURN ? 0 : 1))
+            {
+                script_error(lexer, NULL);
+            }
+            script_next(lexer);
+        }
+    }
+    return script_check(lexer, node);
+}
+
+/*
+* Function: script_valid_name:
+* ----------------------------
+* Checks if a word is a valid name of variable or function: letters, digits
+* and "_", and it does not start with a digit.
+*
+*  name: text of the word, it does not need '\0'.
+*  length: length of the word.
+*
+*  returns: 1 if it is a valid name, otherwise 0.
+*/
+int script_valid_name(char *name, int length)
+{
+    int valid = length > 0 && (isalpha(name[0]) || name[0] == '_');
+    for (int i = 1; valid && i < length; i++)
+    {
+        valid = isalnum(name[i]) || name[i] == '_';
+    }
+    return valid;
+}
+
+/*
+* Function: script_needed:
+* ------------------------
+* Checks if a command line has to be compiled like a script because it 
+* starts with a keyword or defines a function.
+*
+*  line: command line.
+*
+*  returns: 1 if the line has to be compiled, otherwise 0.
+*/
+int script_needed(char *line)
+{
+    const char *keywords[] = {"if", "while", "until", "for", "case", "{",
+                              "break", "continue", "return", NULL};
+
+    // The errors are not shown, they are found when the line is executed.
+    struct script_lexer lexer = {"", line, 1, TOKEN_END, line, 0, 1, 1, 0};
+    if (script_next(&lexer) != TOKEN_WORD)
+    {
+        return 0;
+    }
+    for (int i = 0; keywords[i]; i++)
+    {
+        if (script_is_word(&lexer, keywords[i]))
+        {
+            return 1;
+        }
+    }
+    return script_next(&lexer) == TOKEN_LPAREN;
+}
+
+/*
+* Function: script_line:
+* ----------------------
+* Compiles a command line like a script and executes it.
+*
+*  line: command line.
+*
+*  returns: the exit status of the line, 2 if it has a syntax error.
+*/
+int script_line(char *line)
+{
+    struct script_node *script = script_compile(ms->minishell.command_line,
+                                                line);
+    if (!script)
+    {
+        return ms->last_status = 2;
+    }
+    script_run(script, 0);
+    script_free(script);
+    return ms->last_status;
+}
+
+/*
+* Function: script_next:
+* ----------------------
+* Obtains the next token of the script. The blanks, the escaped new lines
+* and the comments are skipped. The words end with a blank or an operator
+* out of a command substitution.
+*
+*  lexer: lexical analyzer.
+*
+*  returns: the type of the token.
+*/
+int script_next(struct script_lexer *lexer)
+{
+    char *ptr = lexer->pos;
+    int previous = lexer->type;
+    int comment = 0;
+
+    // Skips the blanks, the escaped new lines and the comments.
+    while (1)
+    {
+        if (*ptr == ' ' || *ptr == '\t' || *ptr == '\r')
+        {
+            ptr++;
+        }
+        else if (ptr[0] == '\\' && ptr[1] == '\n')
+        {
+            ptr += 2;
+            lexer->line++;
+        }
+        else if (*ptr == '#')
+        {
+            comment = 1;
+            while (*ptr && *ptr != '\n')
+            {
+                ptr++;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+    lexer->token = ptr;
+    lexer->token_line = lexer->line;
+    lexer->length = 1;
+    lexer->blank = 0;
+    if (!*ptr)
+    {
+        lexer->type = TOKEN_END;
+        lexer->length = 0;
+    }
+    else if (*ptr == '\n')
+    {
+        // A line without commands or comments is empty.
+        lexer->blank = previous == TOKEN_NEWLINE && !comment;
+        lexer->type = TOKEN_NEWLINE;
+        lexer->line++;
+    }
+    else if (ptr[0] == ';' && ptr[1] == ';')
+    {
+        lexer->type = TOKEN_DSEMI;
+        lexer->length = 2;
+    }
+    else if (*ptr == ';')
+    {
+        lexer->type = TOKEN_SEMI;
+    }
+    else if (ptr[0] == '&' && ptr[1] == '&')
+    {
+        lexer->type = TOKEN_AND;
+        lexer->length = 2;
+    }
+    else if (ptr[0] == '|' && ptr[1] == '|')
+    {
+        lexer->type = TOKEN_OR;
+        lexer->length = 2;
+    }
+    else if (*ptr == '|')
+    {
+        lexer->type = TOKEN_PIPE;
+    }
+    else if (*ptr == '(')
+    {
+        lexer->type = TOKEN_LPAREN;
+    }
+    else if (*ptr == ')')
+    {
+        lexer->type = TOKEN_RPAREN;
+    }
+    else
+    {
+        // Looks for the end of the word.
+        int depth = 0;
+        int quoted = 0;
+        char *end = ptr;
+        while (*end)
+        {
+            if (*end == '`')
+            {
+                quoted = !quoted;
+            }
+            else if (*end == '\n' && (depth || quoted))
+            {
+                lexer->line++;
+            }
+            else if (quoted)
+            {
+            }
+            else if (end[0] == '$' && end[1] == '(')
+            {
+                depth++;
+                end++;
+            }
+            else if (depth && *end == '(')
+            {
+                depth++;
+            }
+            else if (depth && *end == ')')
+            {
+                depth--;
+            }
+            else if (!depth && (strchr(" \t\r\n;|()", *end) ||
+                                (end[0] == '&' && end[1] == '&')))
+            {
+                break;
+            }
+            end++;
+        }
+        lexer->type = TOKEN_WORD;
+        lexer->length = end - ptr;
+        if (depth || quoted)
+        {
+            script_error(lexer, depth ? ")" : "`");
+        }
+    }
+    lexer->pos = ptr + lexer->length;
+    return lexer->type;
+}
+
+/*
+* Function: script_is_word:
+* -------------------------
+* Checks if the current token is a word.
+*
+*  lexer: lexical analyzer.
+*  word: word to compare.
+*
+*  returns: 1 if the token is the word, otherwise 0.
+*/
+int script_is_word(struct script_lexer *lexer, const char *word)
+{
+    return lexer->type == TOKEN_WORD &&
+           lexer->length == (int)strlen(word) &&
+           !strncmp(lexer->token, word, lexer->length);
+}
+
+/*
+* Function: script_list_end:
+* --------------------------
+* Checks if the current token is a keyword that ends a list.
+*
+*  lexer: lexical analyzer.
+*
+*  returns: 1 if the token ends a list, otherwise 0.
+*/
+int script_list_end(struct script_lexer *lexer)
+{
+    const char *ends[] = {"then", "elif", "else", "fi", "do", "done", "esac",
+                          "}", NULL};
+    for (int i = 0; ends[i]; i++)
+    {
+        if (script_is_word(lexer, ends[i]))
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+* Function: script_expect:
+* ------------------------
+* Checks that the current token is a keyword and goes to the next token.
+*
+*  lexer: lexical analyzer.
+*  word: keyword expected.
+*
+*  returns: 1 if the token was the keyword, otherwise 0 and the error is
+*           shown.
+*/
+int script_expect(struct script_lexer *lexer, const char *word)
+{
+    if (!script_is_word(lexer, word))
+    {
+        script_error(lexer, word);
+        return 0;
+    }
+    script_next(lexer);
+    return 1;
+}
+
+/*
+* Function: script_error:
+* -----------------------
+* Shows a syntax error at the current token. Only the first error of the
+* script is shown.
+*
+*  lexer: lexical analyzer.
+*  expected: token that was expected or NULL.
+*
+*  returns: void.
+*/
+void script_error(struct script_lexer *lexer, const char *expected)
+{
+    if (lexer->error)
+    {
+        return;
+    }
+    lexer->error = 1;
+    const char *token = lexer->token;
+    int length = lexer->length;
+    if (lexer->type == TOKEN_END)
+    {
+        token = "fin del fichero";
+        length = strlen(token);
+    }
+    else if (lexer->type == TOKEN_NEWLINE)
+    {
+        token = "salto de línea";
+        length = strlen(token);
+    }
+    // Only the first line of the token is shown.
+    const char *line_end = memchr(token, '\n', length);
+    if (line_end && line_end != token)
+    {
+        length = line_end - token;
+    }
+    if (expected)
+    {
+        fprintf(stderr, "%s:%d: error de sintaxis, se esperaba \"%s\" y se "
+                "encontró \"%.*s\"\n", lexer->path, lexer->token_line,
+                expected, length, token);
+    }
+    else
+    {
+        fprintf(stderr, "%s:%d: error de sintaxis cerca de \"%.*s\"\n",
+                lexer->path, lexer->token_line, length, token);
+    }
+}
+
+/*
+* Function: script_node:
+* ----------------------
+* Allocates an empty node at the line of the current token.
+*
+*  lexer: lexical analyzer.
+*  type: type of the node.
+*
+*  returns: the node or NULL if there is no memory.
+*/
+struct script_node *script_node(struct script_lexer *lexer, int type)
+{
+    struct script_node *node = calloc(1, sizeof(struct script_node));
+    if (!node)
+    {
+        perror("calloc");
+        lexer->error = 1;
+        return NULL;
+    }
+    node->type = type;
+    node->line = lexer->token_line;
+    return node;
+}
+
+/*
+* Function: script_check:
+* -----------------------
+* Frees the node if there has been an error while it was compiled.
+*
+*  lexer: lexical analyzer.
+*  node: node compiled.
+*
+*  returns: the node or NULL if there has been an error.
+*/
+struct script_node *script_check(struct script_lexer *lexer,
+                                 struct script_node *node)
+{
+    if (lexer->error)
+    {
+        script_free(node);
+        return NULL;
+    }
+    return node;
+}
+
+/*
+* Function: script_add_word:
+* --------------------------
+* Adds the current word at the end of the words of a node. A node can have at
+* most ARGS_SIZE - 1 words, like a command line.
+*
+*  lexer: lexical analyzer at the word.
+*  node: node where the word is added.
+*
+*  returns: exit success or exit failure if there are too many words or
+*           there is no memory.
+*/
+int script_add_word(struct script_lexer *lexer, struct script_node *node)
+{
+    if (node->n_words == ARGS_SIZE - 1)
+    {
+        fprintf(stderr, "%s:%d: demasiadas palabras, el máximo es %d\n",
+                lexer->path, lexer->token_line, ARGS_SIZE - 1);
+        lexer->error = 1;
+        return EXIT_FAILURE;
+    }
+    if (capture_append(&node->words, lexer->token, lexer->length) ||
+        capture_append(&node->words, "", 1))
+    {
+        lexer->error = 1;
+        return EXIT_FAILURE;
+    }
+    node->n_words++;
+    return EXIT_SUCCESS;
+}
+
+/*
+* Function: script_copy:
+* ----------------------
+* Copies a node and all the nodes that it contains.
+*
+*  node: node to copy, it can be NULL.
+*
+*  returns: the copy, NULL if node is NULL or there is no memory.
+*/
+struct script_node *script_copy(struct script_node *node)
+{
+    struct script_node *first = NULL;
+    struct script_node **last = &first;
+    for (; node; node = node->next)
+    {
+        struct script_node *copy = calloc(1, sizeof(struct script_node));
+        if (!copy)
+        {
+            perror("calloc");
+            script_free(first);
+            return NULL;
+        }
+        *last = copy;
+        last = &copy->next;
+        copy->type = node->type;
+        copy->line = node->line;
+        copy->n_words = node->n_words;
+        copy->count = node->count;
+        copy->newline = node->newline;
+        copy->blank = node->blank;
+        if ((node->words.length &&
+             capture_append(&copy->words, node->words.data,
+                            node->words.length)) ||
+            (node->condition && !(copy->condition = 
+                                  script_copy(node->condition))) ||
+            (node->body && !(copy->body = script_copy(node->body))) ||
+            (node->orelse && !(copy->orelse = script_copy(node->orelse))))
+        {
+            script_free(first);
+            return NULL;
+        }
+    }
+    return first;
+}
+
+/*
+* Function: script_free:
+* ----------------------
+* Frees a node and all the nodes that it contains.
+*
+*  node: node to free, it can be NULL.
+*
+*  returns: void.
+*/
+void script_free(struct script_node *node)
+{
+    while (node)
+    {
+        struct script_node *next = node->next;
+        script_free(node->condition);
+        script_free(node->body);
+        script_free(node->orelse);
+        free(node->words.data);
+        free(node);
+        node = next;
+    }
+}
+
+/*
+* Function: script_run:
+* ---------------------
+* Executes the commands of a list. The statuses of each chain of "&&" and
+* "||" are saved for $PIPESTATUS. The list stops after break, continue and
+* Ctrl+C.
+*
+*  list: node of the list.
+*  notify: 1 to notify the background jobs finished after each command.
+*
+*  returns: the exit status of the last command.
+*/
+int script_run(struct script_node *list, int notify)
+{
+    for (struct script_node *node = list->body; node && !script_stopped();
+         node = node->next)
+    {
+        int statuses[ARGS_SIZE];
+        int n_statuses = 0;
+        script_chain(node, statuses, &n_statuses);
+        if (n_statuses)
+        {
+            memcpy(ms->statuses, statuses, sizeof(int) * n_statuses);
+            ms->n_statuses = n_statuses;
+        }
+        if (notify)
+        {
+            jobs_notify();
+        }
+    }
+    return ms->last_status;
+}
+
+/*
+* Function: script_chain:
+* -----------------------
+* Executes a chain of commands joined with "&&" and "||". The command after
+* "&&" is only executed if the last status is 0 and the command after "||"
+* only if it is not 0.
+*
+*  node: first node of the chain.
+*  statuses: array where the status of each simple command is added.
+*  n_statuses: pointer to the number of statuses in the array.
+*
+*  returns: the exit status of the last command executed.
+*/
+int script_chain(struct script_node *node, int *statuses, int *n_statuses)
+{
+    if (node->type == NODE_AND || node->type == NODE_OR)
+    {
+        script_chain(node->condition, statuses, n_statuses);
+        if (!script_stopped() &&
+            (node->type == NODE_AND) == (ms->last_status == 0))
+        {
+            script_chain(node->body, statuses, n_statuses);
+        }
+    }
+    else
+    {
+        script_execute(node);
+        if (node->type == NODE_COMMAND && *n_statuses < ARGS_SIZE)
+        {
+            statuses[(*n_statuses)++] = ms->last_status;
+        }
+    }
+    return ms->last_status;
+}
+
+/*
+* Function: script_execute:
+* -------------------------
+* Executes a node and saves its exit status in last_status.
+*
+*  node: node to execute.
+*
+*  returns: the exit status of the node.
+*/
+int script_execute(struct script_node *node)
+{
+    int statuses[ARGS_SIZE];
+    int n_statuses = 0;
+    switch (node->type)
+    {
+    case NODE_COMMAND:
+        return script_simple_run(node);
+    case NODE_LIST:
+        return script_run(node, 0);
+    case NODE_AND:
+    case NODE_OR:
+        return script_chain(node, statuses, &n_statuses);
+    case NODE_IF:
+        // Executes the commands of the first condition with status 0.
+        script_run(node->condition, 0);
+        if (script_stopped())
+        {
+            break;
+        }
+        if (!ms->last_status)
+        {
+            script_run(node->body, 0);
+        }
+        else if (node->orelse)
+        {
+            script_execute(node->orelse);
+        }
+        else
+        {
+            ms->last_status = EXIT_SUCCESS;
+        }
+        break;
+    case NODE_WHILE:
+    case NODE_UNTIL:
+        return script_loop_run(node);
+    case NODE_FOR:
+        return script_for_run(node);
+    case NODE_CASE:
+        return script_case_run(node);
+    case NODE_BREAK:
+    case NODE_CONTINUE:
+        return script_jump_run(node);
+    case NODE_RETURN:
+        return script_return_run(node);
+    case NODE_FUNCTION:
+        ms->last_status = function_define(node->words.data, node->body);
+        break;
+    }
+    return ms->last_status;
+}
+
+/*
+* Function: script_simple_run:
+* ----------------------------
+* Executes a simple command with a copy of its tokens, because the execution
+* can modify them.
+*
+*  node: node of the command.
+*
+*  returns: the exit status of the command.
+*/
+int script_simple_run(struct script_node *node)
+{
+    char *tokens[ARGS_SIZE];
+
+    // Updates the jobs list with the jobs reaped since the last command.
+    reap_drain();
+    char *text = script_words(node, tokens);
+    if (!text)
+    {
+        return ms->last_status = EXIT_FAILURE;
+    }
+    ms->exec_next = ms->exec_script && script_tail(ms->exec_script, node);
+    int profiled = ms->profile && profile_begin(node, tokens);
+    execute_args(tokens);
+    if (profiled)
+    {
+        profile_end();
+    }
+    free(text);
+    return ms->last_status;
+}
+
+/*
+* Function: script_loop_run:
+* --------------------------
+* Executes a while or an until loop.
+*
+*  node: node of the loop.
+*
+*  returns: the exit status of the last command of the body, 0 if the body
+*           has not been executed.
+*/
+int script_loop_run(struct script_node *node)
+{
+    int status = EXIT_SUCCESS;
+    ms->loop_depth++;
+    while (1)
+    {
+        script_run(node->condition, 0);
+        if (script_stopped())
+        {
+            if (!script_loop_next())
+            {
+                break;
+            }
+            continue;
+        }
+        // While repeats with status 0 and until with other status.
+        if ((ms->last_status == 0) != (node->type == NODE_WHILE))
+        {
+            break;
+        }
+        status = script_run(node->body, 0);
+        if (!script_loop_next())
+        {
+            break;
+        }
+    }
+    ms->loop_depth--;
+    return ms->last_status = status;
+}
+
+/*
+* Function: script_for_run:
+* -------------------------
+* Executes a for loop. The values are expanded when the loop starts and the
+* variable is an environment variable, like the ones of export.
+*
+*  node: node of the loop.
+*
+*  returns: the exit status of the last command of the body, 0 if the body
+*           has not been executed.
+*/
+int script_for_run(struct script_node *node)
+{
+    char *tokens[ARGS_SIZE];
+    char *text = script_words(node, tokens);
+    if (!text)
+    {
+        return ms->last_status = EXIT_FAILURE;
+    }
+    // Expands the values.
+    struct capture fields = {NULL, 0, 0};
+    char **values = expand_args(tokens + 1, &fields);
+    int status = values ? EXIT_SUCCESS : EXIT_FAILURE;
+    ms->loop_depth++;
+    for (int i = 0; values && values[i]; i++)
+    {
+        setenv(tokens[0], values[i], 1);
+        status = script_run(node->body, 0);
+        if (!script_loop_next())
+        {
+            break;
+        }
+    }
+    ms->loop_depth--;
+    if (values != tokens + 1)
+    {
+        free(values);
+    }
+    free(fields.data);
+    free(text);
+    return ms->last_status = status;
+}
+
+/*
+* Function: script_case_run:
+* --------------------------
+* Executes the commands of the first pattern that matches the word. The
+* patterns accept the wildcards of fnmatch (*, ? and [...]).
+*
+*  node: node of the case.
+*
+*  returns: the exit status of the commands, 0 if no pattern matches.
+*/
+int script_case_run(struct script_node *node)
+{
+    char *tokens[ARGS_SIZE];
+    char *text = script_words(node, tokens);
+    char *subject = malloc(sizeof(char) * COMMAND_LINE_SIZE);
+    if (!text || !subject)
+    {
+        free(text);
+        free(subject);
+        return ms->last_status = EXIT_FAILURE;
+    }
+    // Expands the word, the fields are joined with blanks.
+    struct capture fields = {NULL, 0, 0};
+    char **args = expand_args(tokens, &fields);
+    subject[0] = '\0';
+    if (args && args[0])
+    {
+        join_args(args, subject);
+    }
+    if (args != tokens)
+    {
+        free(args);
+    }
+    free(fields.data);
+    free(text);
+    int status = args ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    // Looks for the first pattern that matches.
+    for (struct script_node *pattern = node->body; !status && pattern;
+         pattern = pattern->next)
+    {
+        int matched = 0;
+        text = script_words(pattern, tokens);
+        struct capture expanded = {NULL, 0, 0};
+        char **patterns = text ? expand_args(tokens, &expanded) : NULL;
+        for (int i = 0; patterns && patterns[i] && !matched; i++)
+        {
+            matched = !fnmatch(patterns[i], subject, 0);
+        }
+        if (patterns != tokens)
+        {
+            free(patterns);
+        }
+        free(expanded.data);
+        free(text);
+        if (matched)
+        {
+            status = script_run(pattern->body, 0);
+            break;
+        }
+    }
+    free(subject);
+    return ms->last_status = status;
+}
+
+/*
+* Function: script_jump_run:
+* --------------------------
+* Executes break and continue: the lists stop until the loop that has to
+* finish or continue.
+*
+*  node: node of break or continue.
+*
+*  returns: exit success or exit failure if it is not inside a loop.
+*/
+int script_jump_run(struct script_node *node)
+{
+    const char *name = node->type == NODE_BREAK ? "break" : "continue";
+    if (!ms->loop_depth)
+    {
+        fprintf(stderr, "%s: solo tiene sentido dentro de un bucle\n", name);
+        return ms->last_status = EXIT_FAILURE;
+    }
+    ms->loop_jump = node->count < ms->loop_depth ? node->count
+                                                 : ms->loop_depth;
+    ms->loop_continue = node->type == NODE_CONTINUE;
+    return ms->last_status = EXIT_SUCCESS;
+}
+
+/*
+* Function: script_return_run:
+* ----------------------------
+* Executes return: the lists stop until the end of the function.
+*
+*  node: node of return.
+*
+*  returns: the status of return or exit failure if it is not inside a 
+*           function.
+*/
+int script_return_run(struct script_node *node)
+{
+    if (!ms->function_depth)
+    {
+        fprintf(stderr, "return: solo tiene sentido dentro de una función\n");
+        return ms->last_status = EXIT_FAILURE;
+    }
+    ms->returning = 1;
+    if (node->count >= 0)
+    {
+        ms->last_status = node->count;
+    }
+    return ms->last_status;
+}
+
+/*
+* Function: script_stopped:
+* -------------------------
+* Checks if the commands have to stop because of Ctrl+C, break, continue or
+* return.
+*
+*  returns: 1 if the commands have to stop, otherwise 0.
+*/
+int script_stopped()
+{
+    return ms->interrupted || ms->loop_jump || ms->returning;
+}
+
+/*
+* Function: script_tail:
+* ----------------------
+* Checks if a command is the last one executed by a node, so nothing of the
+* node is executed after it: the last command of a list, the right side of
+* && and || and the last command of the branches of if. The commands of the
+* loops are never the last one.
+*
+*  node: node that contains the command.
+*  command: node of the command.
+*
+*  returns: 1 if it is the last command of the node, otherwise 0.
+*/
+int script_tail(struct script_node *node, struct script_node *command)
+{
+    while (node && node != command)
+    {
+        switch (node->type)
+        {
+        case NODE_LIST:
+            node = node->body;
+            while (node && node->next)
+            {
+                node = node->next;
+            }
+            break;
+        case NODE_AND:
+        case NODE_OR:
+            node = node->body;
+            break;
+        case NODE_IF:
+            if (script_tail(node->body, command))
+            {
+                return 1;
+            }
+            node = node->orelse;
+            break;
+        default:
+            return 0;
+        }
+    }
+    return node != NULL;
+}
+
+/*
+* Function: script_loop_next:
+* ---------------------------
+* Called by a loop after its body, processes the break and continue.
+*
+*  returns: 1 if the loop continues, 0 if it has to finish.
+*/
+int script_loop_next()
+{
+    if (ms->interrupted || ms->returning)
+    {
+        return 0;
+    }
+    if (!ms->loop_jump)
+    {
+        return 1;
+    }
+    // This loop is the last one that receives the jump.
+    ms->loop_jump--;
+    if (ms->loop_jump)
+    {
+        return 0;
+    }
+    int next = ms->loop_continue;
+    ms->loop_continue = 0;
+    return next;
+}
+
+/*
+* Function: script_words:
+* -----------------------
+* Copies the words of a node and fills an array with a pointer to each word.
+*
+*  node: node with the words.
+*  tokens: array of ARGS_SIZE pointers, it ends with NULL.
+*
+*  returns: the copy of the words allocated with malloc, that has to be
+*           freed, or NULL if there is no memory.
+*/
+char *script_words(struct script_node *node, char **tokens)
+{
+    char *text = malloc(node->words.length + 1);
+    if (!text)
+    {
+        perror("malloc");
+        return NULL;
+    }
+    memcpy(text, node->words.data, node->words.length);
+    char *word = text;
+    for (int i = 0; i < node->n_words; i++)
+    {
+        tokens[i] = word;
+        word += strlen(word) + 1;
+    }
+    tokens[node->n_words] = NULL;
+    return text;
+}
@@ -0,0 +1,232 @@
+/*
+* Trace of libminishell: ring buffer of events of the minishell and its 
+* export in chrome trace format.
+*
+* Authors: Aguilar Ferrer, Felix
+*          Bennasar Polzin, Adrian
+*          Lopez Bueno, Alvaro
+*
+* Date: 15/12/2019
+*/
+
+#include "ms_internal.h"
+
+/*
+* Function: internal_trace:
+* -------------------------
+* Controls the tracing of the minishell. "trace start" clears the buffer and
+* starts recording events, "trace stop" stops recording and "trace dump file"
+* writes the recorded events in chrome trace format (chrome://tracing or 
+* Perfetto).
+*
+*  args: pointer array that storages all the tokens in a command line.
+*
+*  returns: exit success or exit failure if the command was not correct.
+*/
+int internal_trace(char **args)
+{
+    if (args[1] && !strcmp(args[1], "start") && !args[2])
+    {
+        // The ring is allocated the first time, shared so sons can use it.
+        if (!ms->trace_ring)
+        {
+            ms->trace_ring = mmap(NULL, sizeof(struct trace_ring),
+                              PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+            if (ms->trace_ring == MAP_FAILED)
+            {
+                ms->trace_ring = NULL;
+                perror("mmap");
+                return EXIT_FAILURE;
+            }
+        }
+        // Clears the previous events and starts recording.
+        ms->trace_ring->enabled = 0;
+        __atomic_store_n(&ms->trace_ring->head, 0, __ATOMIC_RELAXED);
+        memset(ms->trace_ring->events, 0, sizeof(ms->trace_ring->events));
+        __atomic_store_n(&ms->trace_ring->enabled, 1, __ATOMIC_RELEASE);
+        return EXIT_SUCCESS;
+    }
+    else if (args[1] && !strcmp(args[1], "stop") && !args[2])
+    {
+        if (ms->trace_ring)
+        {
+            __atomic_store_n(&ms->trace_ring->enabled, 0, __ATOMIC_RELEASE);
+        }
+        return EXIT_SUCCESS;
+    }
+    else if (args[1] && !strcmp(args[1], "dump") && args[2] && !args[3])
+    {
+        return trace_dump(args[2]);
+    }
+    fprintf(stderr, "La sintaxis es errónea, trace start|stop|dump fichero\n");
+    return EXIT_FAILURE;
+}
+
+/*
+* Function: ms_trace:
+* -------------------
+* Records an event in the trace of the context, used by the programs that 
+* use the library to show their own work in the trace.
+*
+*  ctx: context of the minishell.
+*  phase: chrome trace phase of the event.
+*  name: static name of the event.
+*  detail: short text for the event.
+*  arg: numeric argument of the event.
+*
+*  returns: void.
+*/
+void ms_trace(struct ms_context *ctx, char phase, const char *name,
+              const char *detail, long arg)
+{
+    trace_event(phase, name, detail, arg);
+}
+
+/*
+* Function: trace_event:
+* ----------------------
+* Records an event in the trace ring buffer if tracing is enabled. The slot is
+* reserved with an atomic increment, so it can be used from signal handlers 
+* and from the sons before exec without locks. When the buffer is full the 
+* oldest events are overwritten.
+*
+*  phase: chrome trace phase of the event.
+*  name: static name of the event.
+*  detail: short text for the event, it is truncated on a character boundary.
+*  arg: numeric argument of the event.
+*
+*  returns: void.
+*/
+void trace_event(char phase, const char *name, const char *detail, long arg)
+{
+    // Nothing is recorded while tracing is stopped.
+    if (!ms->trace_ring ||
+        !__atomic_load_n(&ms->trace_ring->enabled, __ATOMIC_ACQUIRE))
+    {
+        return;
+    }
+    // Reserves a slot and marks it as being written.
+    unsigned long slot = __atomic_fetch_add(&ms->trace_ring->head, 1,
+                                            __ATOMIC_RELAXED);
+    struct trace_event *event =
+        &ms->trace_ring->events[slot & (TRACE_EVENTS - 1)];
+    __atomic_store_n(&event->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    // Fills the event (strncpy is avoided because of signal handlers).
+    event->ts = monotonic_ns();
+    event->tid = getpid();
+    event->phase = phase;
+    event->name = name;
+    event->arg = arg;
+    int i = 0;
+    while (detail && detail[i] && i < TRACE_DETAIL_SIZE - 1)
+    {
+        event->detail[i] = detail[i];
+        i++;
+    }
+    // A multibyte character cut by the size is removed, the detail is utf-8.
+    while (detail && i > 0 && ((unsigned char)detail[i] & 0xC0) == 0x80)
+    {
+        i--;
+    }
+    event->detail[i] = '\0';
+
+    // Publishes the event.
+    __atomic_store_n(&event->seq, slot + 1, __ATOMIC_RELEASE);
+}
+
+/*
+* Function: trace_dump:
+* ---------------------
+* Writes the events stored in the ring buffer into a json file using the 
+* chrome trace format. The sons of the minishell are shown as threads. Each
+* event is copied and its seq is checked again after the copy, so an event
+* that is rewritten while it is dumped is skipped instead of written mixed.
+*
+*  path: name of the file to write.
+*
+*  returns: exit success or exit failure if the file could not be written.
+*/
+int trace_dump(char *path)
+{
+    if (!ms->trace_ring)
+    {
+        fprintf(stderr, "No hay ninguna traza, use trace start.\n");
+        return EXIT_FAILURE;
+    }
+    FILE *fp = fopen(path, "we");
+    if (!fp)
+    {
+        perror("fopen");
+        return EXIT_FAILURE;
+    }
+    // Only the last TRACE_EVENTS events are still in the buffer.
+    unsigned long head = __atomic_load_n(&ms->trace_ring->head,
+                                         __ATOMIC_ACQUIRE);
+    unsigned long slot = head > TRACE_EVENTS ? head - TRACE_EVENTS : 0;
+    int first = 1;
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (; slot < head; slot++)
+    {
+        struct trace_event *shared = &ms->trace_ring->events[slot &
+                                                         (TRACE_EVENTS - 1)];
+
+        // Copies the event and skips it if it was incomplete or if it was
+        // overwritten by a son or a signal handler while it was copied.
+        if (__atomic_load_n(&shared->seq, __ATOMIC_ACQUIRE) != slot + 1)
+        {
+            continue;
+        }
+        struct trace_event copy;
+        memcpy(&copy, shared, sizeof(copy));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&shared->seq, __ATOMIC_RELAXED) != slot + 1)
+        {
+            continue;
+        }
+        struct trace_event *event = &copy;
+        event->detail[TRACE_DETAIL_SIZE - 1] = '\0';
+        fprintf(fp, "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\","
+                    "\"ts\":%lld.%03lld,\"pid\":%d,\"tid\":%d,",
+                first ? "" : ",\n", event->name,
+                event->phase == 'b' || event->phase == 'e' ? "job" : "shell",
+                event->phase, event->ts / 1000, event->ts % 1000,
+                ms->minishell.pid, event->tid);
+        if (event->phase == 'b' || event->phase == 'e')
+        {
+            fprintf(fp, "\"id\":%ld,", event->arg);
+        }
+        else if (event->phase == 'i')
+        {
+            fprintf(fp, "\"s\":\"t\",");
+        }
+        // Writes the detail escaping the special characters of json.
+        fprintf(fp, "\"args\":{\"arg\":%ld,\"detail\":\"", event->arg);
+        for (char *c = event->detail; *c; c++)
+        {
+            if (*c == '"' || *c == '\\')
+            {
+                fprintf(fp, "\\%c", *c);
+            }
+            else if ((unsigned char)*c < ' ')
+            {
+                fprintf(fp, "\\u%04x", *c);
+            }
+            else
+            {
+                fputc(*c, fp);
+            }
+        }
+        fprintf(fp, "\"}}");
+        first = 0;
+    }
+    fprintf(fp, "\n]}\n");
+    if (fclose(fp))
+    {
+        perror("fclose");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}